@@ -30,7 +30,7 @@ public class MainActivity extends Activity {
                         case MotionEvent.ACTION_UP:
                         case MotionEvent.ACTION_POINTER_UP:
                         case MotionEvent.ACTION_CANCEL:
-                            mView.queueEvent(new Runnable() {
+                            queueInput(new Runnable() {
                                 @Override
                                 public void run() {
                                     NativeWrapper.OnPointerUp(pointerId, normX, normY);
@@ -39,7 +39,7 @@ public class MainActivity extends Activity {
                             return true;
                         case MotionEvent.ACTION_DOWN:
                         case MotionEvent.ACTION_POINTER_DOWN:
-                            mView.queueEvent(new Runnable() {
+                            queueInput(new Runnable() {
                                 @Override
                                 public void run() {
                                     NativeWrapper.OnPointerDown(pointerId, normX, normY);
@@ -47,7 +47,7 @@ public class MainActivity extends Activity {
                             });
                             return true;
                         case MotionEvent.ACTION_MOVE:
-                            mView.queueEvent(new Runnable() {
+                            queueInput(new Runnable() {
                                 @Override
                                 public void run() {
                                     NativeWrapper.OnPointerMove(pointerId, normX, normY);
@@ -66,6 +66,13 @@ public class MainActivity extends Activity {
         setContentView(mView);
     }
     
+    //Касание передается в поток GL и будит отрисовку, если она остановлена на паузе
+    //Кадр запрашивается после события, иначе он мог бы нарисоваться без него
+    private void queueInput(Runnable r) {
+        mView.queueEvent(r);
+        mView.requestRender();
+    }
+
     @Override
     protected void onPause() {
     	super.onPause();
@@ -8,14 +8,78 @@ import javax.microedition.khronos.opengles.GL10;
 import android.content.Context;
 import android.opengl.GLSurfaceView;
 import android.os.Build;
+import android.view.Choreographer;
+import android.view.WindowManager;
 
 public class MainView extends GLSurfaceView {
 
+	//Время последнего vsync, пишется в главном потоке, читается в потоке GL
+	private volatile long mVsyncNanos = 0;
+	private final VsyncTracker mVsyncTracker;
+
 	public MainView(Context context) {
 		super(context);
 		setEGLContextClientVersion(2);
-		setEGLConfigChooser(new MultiSampleConfigChooser(16));
-		setRenderer(new Renderer());
+		setEGLConfigChooser(new MultiSampleConfigChooser(NativeWrapper.GetMultiSamples()));
+		setRenderer(new Renderer(this));
+
+		final float refreshRate = ((WindowManager) context.getSystemService(Context.WINDOW_SERVICE))
+				.getDefaultDisplay().getRefreshRate();
+		queueEvent(new Runnable() {
+			@Override
+			public void run() {
+				NativeWrapper.SetRefreshRate(refreshRate);
+			}
+		});
+		//Choreographer есть с API 16, на старых версиях шаг считается по таймеру
+		mVsyncTracker = Build.VERSION.SDK_INT >= Build.VERSION_CODES.JELLY_BEAN ? new VsyncTracker() : null;
+	}
+
+	@Override
+	public void onResume() {
+		super.onResume();
+		setVsyncTracking(true);
+	}
+
+	@Override
+	public void onPause() {
+		setVsyncTracking(false);
+		super.onPause();
+	}
+
+	//Отслеживание vsync не нужно, пока кадр неподвижен. Можно вызывать из любого потока
+	private void setVsyncTracking(final boolean enable) {
+		if (mVsyncTracker == null) return;
+		post(new Runnable() {
+			@Override
+			public void run() {
+				mVsyncTracker.setEnabled(enable);
+			}
+		});
+	}
+
+	//Callback на каждый vsync, только в главном потоке
+	private class VsyncTracker implements Choreographer.FrameCallback {
+
+		private boolean mEnabled = false;
+
+		public void setEnabled(boolean enable) {
+			if (enable == mEnabled) return;
+			mEnabled = enable;
+			//Время vsync до перерыва устарело: пока не придет новый, кадры идут по таймеру (0)
+			mVsyncNanos = 0;
+			if (enable) {
+				Choreographer.getInstance().postFrameCallback(this);
+			} else {
+				Choreographer.getInstance().removeFrameCallback(this);
+			}
+		}
+
+		@Override
+		public void doFrame(long frameTimeNanos) {
+			mVsyncNanos = frameTimeNanos;
+			if (mEnabled) Choreographer.getInstance().postFrameCallback(this);
+		}
 	}
 
     //Включаем сглаживание
@@ -74,6 +138,13 @@ public class MainView extends GLSurfaceView {
 
 	private static class Renderer implements GLSurfaceView.Renderer {
 
+		private final MainView mView;
+		private boolean mContinuous = true;
+
+		public Renderer(MainView view) {
+			mView = view;
+		}
+
 		@Override
 		public void onSurfaceCreated(GL10 gl, EGLConfig config) {
             NativeWrapper.GLCreated();
@@ -86,7 +157,13 @@ public class MainView extends GLSurfaceView {
 
 		@Override
 		public void onDrawFrame(GL10 gl) {
-            NativeWrapper.Update();
+            //Пока кадр неподвижен, рисуем только по запросу (касание, возобновление)
+            boolean continuous = NativeWrapper.Update(mView.mVsyncNanos);
+            if (continuous != mContinuous) {
+                mContinuous = continuous;
+                mView.setRenderMode(continuous ? RENDERMODE_CONTINUOUSLY : RENDERMODE_WHEN_DIRTY);
+                mView.setVsyncTracking(continuous);
+            }
 		}
 
     }
@@ -8,14 +8,27 @@ import android.os.Vibrator;
 public class NativeWrapper {
 	
 	static {
+        //Время начала загрузки передаем для трассировки холодного старта
+        long loadStart = System.nanoTime();
         System.loadLibrary("Asteroids");
+        Init(loadStart, App.getContext().getFilesDir().getAbsolutePath());
     }
 
+    public static native void Init(long loadStartNanos, String filesDir);
+
+    //Сколько образцов MSAA запрашивать (0 - сглаживание в шейдере)
+    public static native int GetMultiSamples();
+
     public static native void GLCreated();
 
 	public static native void GLChanged(int width, int height);
 	
-	public static native void Update();
+    //Частота обновления экрана, для шага по vsync
+    public static native void SetRefreshRate(float hz);
+
+	//vsyncNanos - время последнего vsync от Choreographer (0 - неизвестно, шаг по таймеру)
+	//false - кадр неподвижен (пауза), перерисовывать только по касанию
+	public static native boolean Update(long vsyncNanos);
 
     public static native void OnPointerDown(int id, float x, float y);
 
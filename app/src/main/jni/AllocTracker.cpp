@@ -0,0 +1,264 @@
+#include <AllocTracker.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <dlfcn.h>
+
+namespace {
+    using AllocTracker::Scope;
+    constexpr int scopeCount = static_cast<int>(Scope::Count);
+    const char* const scopeNames[scopeCount] = {"other", "sim", "collision", "render", "input", "score"};
+
+    thread_local int guardDepth = 0;
+    thread_local int guardCount = 0;
+    thread_local int exemptDepth = 0;
+    thread_local Scope curScope = Scope::Other;
+    thread_local const char* curSite = nullptr;
+
+    //Перед каждым блоком - размер и подсистема, чтобы учитывать освобождения
+    //Размер заголовка сохраняет выравнивание malloc
+    struct alignas(16) Header {
+        size_t size;
+        Scope scope;
+    };
+
+    struct Counters {
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+        uint64_t frees = 0;
+    };
+
+    //Место выделения: имя (Site) или адрес возврата
+    struct SiteStat {
+        const void* key;
+        bool named;
+        uint64_t allocs;
+        uint64_t bytes;
+    };
+
+    //Внутри operator new нельзя выделять память, поэтому всё в статических массивах
+    constexpr int siteTableSize = 512;
+    SiteStat sites[siteTableSize];
+    int siteOverflow = 0;
+    Counters frame[scopeCount];
+    Counters window[scopeCount];
+    int windowFrames = 0;
+    int windowCleanFrames = 0;
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+    struct LockGuard {
+        LockGuard() {while(lock.test_and_set(std::memory_order_acquire));};
+        ~LockGuard() {lock.clear(std::memory_order_release);};
+    };
+
+    void RecordSite(const void* key, bool named, size_t size) {
+        size_t h = (reinterpret_cast<uintptr_t>(key) >> 3) % siteTableSize;
+        for(int i = 0; i < siteTableSize; ++i) {
+            SiteStat& s = sites[(h + i) % siteTableSize];
+            if(!s.key) {
+                s.key = key;
+                s.named = named;
+            }
+            if(s.key == key) {
+                s.allocs++;
+                s.bytes += size;
+                return;
+            }
+        }
+        siteOverflow++;
+    }
+
+    void* Allocate(size_t size, const void* caller) {
+        if(Constant::frameHeapGuard && guardDepth > 0 && exemptDepth == 0) guardCount++;
+        if(!Constant::trackAllocations) return malloc(size ? size : 1);
+
+        Header* h = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if(!h) return nullptr;
+        h->size = size;
+        h->scope = curScope;
+        {
+            LockGuard l;
+            Counters& c = frame[static_cast<int>(curScope)];
+            c.allocs++;
+            c.bytes += size;
+            RecordSite(curSite ? static_cast<const void*>(curSite) : caller, curSite != nullptr, size);
+        }
+        return h + 1;
+    }
+
+    void Deallocate(void* p) {
+        if(!p) return;
+        if(!Constant::trackAllocations) {
+            free(p);
+            return;
+        }
+        Header* h = static_cast<Header*>(p) - 1;
+        {
+            LockGuard l;
+            frame[static_cast<int>(h->scope)].frees++;
+        }
+        free(h);
+    }
+
+    //Для обычных operator new: при нехватке памяти - std::bad_alloc, как у стандартных
+    //Без поддержки исключений (-fno-exceptions) остается только abort
+    void* AllocateOrThrow(size_t size, const void* caller) {
+        void* p = Allocate(size, caller);
+        if(!p) {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        return p;
+    }
+}
+
+
+///AllocTracker///
+
+AllocTracker::ScopeGuard::ScopeGuard(Scope scope) : prev(curScope) {
+    curScope = scope;
+}
+
+AllocTracker::ScopeGuard::~ScopeGuard() {
+    curScope = prev;
+}
+
+AllocTracker::Site::Site(const char* name) : prev(curSite) {
+    curSite = name;
+}
+
+AllocTracker::Site::~Site() {
+    curSite = prev;
+}
+
+void AllocTracker::EndFrame() {
+    if(!Constant::trackAllocations) return;
+    bool report = false;
+    {
+        LockGuard l;
+        bool clean = true;
+        for(int i = 0; i < scopeCount; ++i) {
+            if(frame[i].allocs) clean = false;
+            window[i].allocs += frame[i].allocs;
+            window[i].bytes += frame[i].bytes;
+            window[i].frees += frame[i].frees;
+            frame[i] = Counters();
+        }
+        windowFrames++;
+        if(clean) windowCleanFrames++;
+        report = windowFrames >= Constant::allocReportFrames;
+    }
+    if(report) Report();
+}
+
+void AllocTracker::Report() {
+    if(!Constant::trackAllocations) return;
+    //Копируем под блокировкой, выводим без нее: логирование само может выделять память
+    Counters w[scopeCount];
+    SiteStat top[Constant::allocReportSites];
+    int frames, clean, overflow, topCount = 0;
+    {
+        LockGuard l;
+        std::copy(window, window + scopeCount, w);
+        frames = std::max(windowFrames, 1);
+        clean = windowCleanFrames;
+        overflow = siteOverflow;
+        for(auto& s : sites) {
+            if(!s.key) continue;
+            //Вставка в отсортированный по убыванию количества список лучших мест
+            int pos = topCount;
+            while(pos > 0 && top[pos - 1].allocs < s.allocs) pos--;
+            if(pos >= Constant::allocReportSites) continue;
+            int last = std::min(topCount, Constant::allocReportSites - 1);
+            for(int i = last; i > pos; --i) top[i] = top[i - 1];
+            top[pos] = s;
+            topCount = std::min(topCount + 1, Constant::allocReportSites);
+        }
+        std::fill(window, window + scopeCount, Counters());
+        std::fill(sites, sites + siteTableSize, SiteStat());
+        windowFrames = 0;
+        windowCleanFrames = 0;
+        siteOverflow = 0;
+    }
+
+    LOGI("Allocations over %d frames, %d without heap use", frames, clean);
+    for(int i = 0; i < scopeCount; ++i) {
+        if(!w[i].allocs && !w[i].frees) continue;
+        LOGI("  %-9s %8.3f allocs/frame %10.1f B/frame %8.3f frees/frame", scopeNames[i],
+             (double)w[i].allocs / frames, (double)w[i].bytes / frames, (double)w[i].frees / frames);
+    }
+    for(int i = 0; i < topCount; ++i) {
+        const SiteStat& s = top[i];
+        if(s.named) {
+            LOGI("  #%d %s: %llu allocs, %llu B", i + 1, static_cast<const char*>(s.key),
+                 (unsigned long long)s.allocs, (unsigned long long)s.bytes);
+        } else {
+            Dl_info info;
+            const char* name = dladdr(s.key, &info) && info.dli_sname ? info.dli_sname : "?";
+            LOGI("  #%d %p (%s): %llu allocs, %llu B", i + 1, s.key, name,
+                 (unsigned long long)s.allocs, (unsigned long long)s.bytes);
+        }
+    }
+    if(overflow) LOGW("  %d allocations from untracked sites (table full)", overflow);
+}
+
+
+///HeapGuard///
+
+void HeapGuard::Begin() {
+    if(guardDepth++ == 0) guardCount = 0;
+}
+
+int HeapGuard::End() {
+    guardDepth--;
+    return guardCount;
+}
+
+HeapGuard::Exempt::Exempt() {
+    exemptDepth++;
+}
+
+HeapGuard::Exempt::~Exempt() {
+    exemptDepth--;
+}
+
+
+//Глобальные operator new/delete. Все варианты заменяются вместе,
+//иначе память с заголовком могла бы освобождаться стандартным delete и наоборот
+void* operator new(size_t size) {
+    return AllocateOrThrow(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size) {
+    return AllocateOrThrow(size, __builtin_return_address(0));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void* p) noexcept {
+    Deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+    Deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    Deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    Deallocate(p);
+}
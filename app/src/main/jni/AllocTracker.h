@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Utils.h>
+
+//Учет обращений к куче через глобальные operator new/delete (AllocTracker.cpp)
+//Всё включается на этапе компиляции: Constant::trackAllocations и Constant::frameHeapGuard.
+//Без них operator new/delete - просто malloc/free
+namespace AllocTracker {
+    //Подсистема, которой приписывается выделение
+    enum class Scope : uint8_t {
+        Other, Sim, Collision, Render, Input, Score, Count
+    };
+
+    //Выделения внутри блока приписываются подсистеме scope (в текущем потоке)
+    class ScopeGuard {
+        Scope prev;
+    public:
+        explicit ScopeGuard(Scope scope);
+        ~ScopeGuard();
+        ScopeGuard(const ScopeGuard&) = delete;
+        ScopeGuard& operator=(const ScopeGuard&) = delete;
+    };
+
+    //Именованное место выделения. Без него место определяется по адресу возврата
+    //из operator new, что после встраивания шаблонов STL часто малоинформативно
+    class Site {
+        const char* prev;
+    public:
+        explicit Site(const char* name);
+        ~Site();
+        Site(const Site&) = delete;
+        Site& operator=(const Site&) = delete;
+    };
+
+    //Конец кадра (после отрисовки в Game::Update): раз в Constant::allocReportFrames кадров статистика выводится в лог
+    void EndFrame();
+    //Выделения по подсистемам за кадр в среднем и самые частые места выделения
+    void Report();
+}
+
+//Отладка: подсчет обращений к куче в текущем потоке
+//Работает, только если включен Constant::frameHeapGuard
+namespace HeapGuard {
+    void Begin();
+    //Возвращает количество выделений с момента Begin
+    int End();
+
+    //Выделения внутри блока не считаются: объекты и модели живут дольше кадра
+    class Exempt {
+    public:
+        Exempt();
+        ~Exempt();
+        Exempt(const Exempt&) = delete;
+        Exempt& operator=(const Exempt&) = delete;
+    };
+}
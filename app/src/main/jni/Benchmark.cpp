@@ -0,0 +1,290 @@
+#include <Benchmark.h>
+#include <Game.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    constexpr int repeats = 15;
+    constexpr unsigned seed = 20161;
+    constexpr int inputCount = 64; //размер набора входных данных, операции идут по кругу
+    constexpr float dt = 1.0f / 60.0f;
+
+    std::string gFilter;
+    volatile float gSink; //чтобы компилятор не выбросил результат
+
+    //setup выполняется перед каждым повтором и в замер не входит,
+    //body(i) - одна операция, возвращает значение, которое идет в gSink.
+    //Первый повтор - прогрев, в результат не входит
+    template <class Setup, class Body>
+    void Measure(std::vector<Benchmark::Result>& out, const char* name, int ops, Setup setup, Body body) {
+        if(!gFilter.empty() && std::string(name).find(gFilter) == std::string::npos) return;
+        std::vector<double> samples;
+        float acc = 0.f;
+        for(int r = -1; r < repeats; ++r) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            for(int i = 0; i < ops; ++i) {
+                acc += body(i);
+            }
+            auto end = std::chrono::steady_clock::now();
+            if(r >= 0) samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / ops);
+        }
+        gSink = acc;
+
+        double mean = 0.0, var = 0.0;
+        for(double s : samples) mean += s;
+        mean /= samples.size();
+        for(double s : samples) var += (s - mean) * (s - mean);
+        var /= samples.size() > 1 ? samples.size() - 1 : 1;
+        out.push_back(Benchmark::Result{name, mean, std::sqrt(var), ops, repeats});
+    }
+
+    void NoSetup() {}
+
+    //Порядок вычисления аргументов не определен, поэтому случайные значения - по одному
+    Vec2 RandomVec(std::uniform_real_distribution<float>& xs, std::uniform_real_distribution<float>& ys,
+                   std::default_random_engine& gen) {
+        float x = xs(gen);
+        return Vec2(x, ys(gen));
+    }
+
+    struct SegmentInput {
+        Vec2 p, r, vp, q, s, vq;
+    };
+
+    //Отрезки размером с ребро модели в пределах экрана, скорости порядка скоростей объектов
+    std::vector<SegmentInput> MakeSegments(std::default_random_engine& gen) {
+        std::uniform_real_distribution<float> pos(-1.f, 1.f), edge(-0.2f, 0.2f), vel(-1.f, 1.f);
+        std::vector<SegmentInput> in(inputCount * 16);
+        for(auto& s : in) {
+            s.p = RandomVec(pos, pos, gen) * 0.2f;
+            s.r = RandomVec(edge, edge, gen);
+            s.vp = RandomVec(vel, vel, gen);
+            s.q = RandomVec(pos, pos, gen) * 0.2f;
+            s.s = RandomVec(edge, edge, gen);
+            s.vq = RandomVec(vel, vel, gen);
+        }
+        return in;
+    }
+
+    std::vector<std::shared_ptr<Model>> MakeAsteroids(Random& random) {
+        std::vector<std::shared_ptr<Model>> models;
+        for(int i = 0; i < inputCount; ++i) {
+            models.push_back(Model::CreateAsteroid(random));
+        }
+        return models;
+    }
+
+    std::vector<Transform> MakeTransforms(std::default_random_engine& gen) {
+        std::uniform_real_distribution<float> x(-Constant::worldRatio, Constant::worldRatio), y(-1.f, 1.f);
+        std::uniform_real_distribution<float> angle(0.f, 2.f * FastMath::pi);
+        std::vector<Transform> ts;
+        for(int i = 0; i < inputCount; ++i) {
+            Vec2 pos = RandomVec(x, y, gen);
+            ts.push_back(Transform(pos, angle(gen)));
+        }
+        return ts;
+    }
+}
+
+std::vector<Benchmark::Result> Benchmark::Run(const std::string& filter) {
+    gFilter = filter;
+    std::vector<Result> results;
+    SegmentCollision(results);
+    MovingSegmentCollision(results);
+    RefineCollision(results);
+    ApplyTransform(results);
+    CalcRadius(results);
+    DefaultIndices(results);
+    Split(results);
+    CreateAsteroid(results);
+    BatchPack(results);
+    return results;
+}
+
+std::string Benchmark::ToJson(const std::vector<Result>& results) {
+    std::string json = "{\"benchmarks\": [";
+    char buf[256];
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        snprintf(buf, sizeof(buf), "%s\n  {\"name\": \"%s\", \"ns_per_op\": %.3f, \"stddev\": %.3f, \"ops\": %d, \"repeats\": %d}",
+                 i ? "," : "", r.name.c_str(), r.nsPerOp, r.stdDev, r.opsPerRepeat, r.repeats);
+        json += buf;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+void Benchmark::Log(const std::vector<Result>& results) {
+    for(const Result& r : results) {
+        LOGI("Benchmark %-28s %10.1f ns/op +- %.1f (%d ops x %d)",
+             r.name.c_str(), r.nsPerOp, r.stdDev, r.opsPerRepeat, r.repeats);
+    }
+}
+
+
+///Геометрия///
+
+void Benchmark::SegmentCollision(std::vector<Result>& out) {
+    Game game(seed);
+    std::default_random_engine gen(seed);
+    std::vector<SegmentInput> in = MakeSegments(gen);
+    Measure(out, "Game::SegmentCollision", 100000, NoSetup, [&](int i) {
+        const SegmentInput& s = in[i % in.size()];
+        return game.SegmentCollision(s.p, s.r, s.q, s.s) ? 1.f : 0.f;
+    });
+}
+
+void Benchmark::MovingSegmentCollision(std::vector<Result>& out) {
+    Game game(seed);
+    std::default_random_engine gen(seed);
+    std::vector<SegmentInput> in = MakeSegments(gen);
+    Measure(out, "Game::MovingSegmentCollision", 100000, NoSetup, [&](int i) {
+        const SegmentInput& s = in[i % in.size()];
+        return game.MovingSegmentCollision(s.p, s.r, s.vp, s.q, s.s, s.vq, dt) ? 1.f : 0.f;
+    });
+}
+
+//Пары, которые действительно доходят до точной проверки: корабль и пуля против астероида и НЛО,
+//вторые объекты на расстоянии не больше суммы радиусов
+void Benchmark::RefineCollision(std::vector<Result>& out) {
+    Game game(seed);
+    std::default_random_engine gen(seed);
+    std::uniform_real_distribution<float> x(-Constant::worldRatio, Constant::worldRatio), y(-1.f, 1.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f), angle(0.f, 2.f * FastMath::pi);
+
+    std::vector<std::pair<GameObject*, GameObject*>> pairs, bulletPairs;
+    for(int i = 0; i < inputCount; ++i) {
+        Vec2 targetPos = RandomVec(x, y, gen);
+        Transform at(targetPos, angle(gen));
+        GameObject& target = (i % 2) ? GameObject::Create<UFO>(game, at) : GameObject::Create<Asteroid>(game, at);
+        float dist = unit(gen) * target.getRadius() * 1.2f;
+        float a = angle(gen);
+        Vec2 pos = at.getPos() + Vec2(cos(a), sin(a)) * dist;
+
+        GameObject& ship = GameObject::Create<Ship>(game, pos.x, pos.y, angle(gen));
+        ship.setVelocity(RandomVec(unit, unit, gen) - Vec2(0.5f, 0.5f));
+        pairs.push_back(std::make_pair(&ship, &target));
+
+        Bullet& bullet = GameObject::Create<Bullet>(game, pos.x, pos.y, a + FastMath::halfPi).as<Bullet>();
+        bullet.setVelocity(Vec2(-sin(a), cos(a)) * Constant::bulletSpeedBasic);
+        bulletPairs.push_back(std::make_pair(&bullet, &target));
+    }
+
+    Measure(out, "Game::RefineCollision", 20000, NoSetup, [&](int i) {
+        const auto& p = pairs[i % pairs.size()];
+        return game.RefineCollision(*p.first, *p.second, dt) ? 1.f : 0.f;
+    });
+    Measure(out, "Game::RefineCollision/bullet", 20000, NoSetup, [&](int i) {
+        const auto& p = bulletPairs[i % bulletPairs.size()];
+        return game.RefineCollision(*p.first, *p.second, dt) ? 1.f : 0.f;
+    });
+    Measure(out, "Game::RefineBulletCollision", 20000, NoSetup, [&](int i) {
+        const auto& p = bulletPairs[i % bulletPairs.size()];
+        return game.RefineBulletCollision(p.first->as<Bullet>(), *p.second, dt) ? 1.f : 0.f;
+    });
+}
+
+
+///Модели///
+
+void Benchmark::ApplyTransform(std::vector<Result>& out) {
+    Random random(seed);
+    std::vector<std::shared_ptr<Model>> models = MakeAsteroids(random);
+    std::vector<Transform> ts = MakeTransforms(random.generator);
+    Measure(out, "Model::ApplyTransform", 50000, NoSetup, [&](int i) {
+        Model& m = *models[i % inputCount];
+        m.ApplyTransform(ts[i % inputCount]);
+        return m.getTransformed()[0];
+    });
+}
+
+void Benchmark::CalcRadius(std::vector<Result>& out) {
+    Random random(seed);
+    std::vector<std::shared_ptr<Model>> models = MakeAsteroids(random);
+    Measure(out, "Model::CalcRadius", 50000, NoSetup, [&](int i) {
+        return models[i % inputCount]->CalcRadius();
+    });
+}
+
+void Benchmark::DefaultIndices(std::vector<Result>& out) {
+    Random random(seed);
+    std::vector<std::shared_ptr<Model>> models = MakeAsteroids(random);
+    Measure(out, "Model::DefaultIndices", 50000, NoSetup, [&](int i) {
+        return static_cast<float>(Model::DefaultIndices(models[i % inputCount]->getVerts().size(), false).back());
+    });
+}
+
+void Benchmark::CreateAsteroid(std::vector<Result>& out) {
+    Random random(seed);
+    Measure(out, "Model::CreateAsteroid", 20000, NoSetup, [&](int) {
+        return Model::CreateAsteroid(random)->getRadius();
+    });
+}
+
+//Каждый повтор раскалывает заново созданные большие астероиды,
+//осколки и временные данные убираются перед следующим повтором
+void Benchmark::Split(std::vector<Result>& out) {
+    const int ops = 128;
+    Game game(seed);
+    std::default_random_engine gen(seed);
+    std::uniform_real_distribution<float> x(-Constant::worldRatio, Constant::worldRatio), y(-1.f, 1.f);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<Asteroid*> asteroids;
+    std::vector<Vec2> hits;
+    auto setup = [&] {
+        game.ClearObjects();
+        game.frameArena.Reset();
+        game.random.generator.seed(seed);
+        gen.seed(seed);
+        asteroids.clear();
+        hits.clear();
+        for(int i = 0; i < ops; ++i) {
+            Vec2 pos = RandomVec(x, y, gen);
+            Asteroid& a = GameObject::Create<Asteroid>(game, Transform(pos)).as<Asteroid>();
+            asteroids.push_back(&a);
+            hits.push_back(a.getPosition() + RandomVec(unit, unit, gen) * a.getRadius());
+        }
+    };
+    Measure(out, "Asteroid::Split", ops, setup, [&](int i) {
+        asteroids[i]->Split(hits[i], Vec2(0.f, Constant::bulletSpeedBasic));
+        return 0.f;
+    });
+    game.ClearObjects();
+}
+
+
+///Отрисовка без OpenGL///
+
+//Типичный кадр: корабль, астероиды и пули. Упаковка в буферы батча и единого батча
+void Benchmark::BatchPack(std::vector<Result>& out) {
+    Renderer renderer;
+    Batch batch(renderer, false);
+    batch.mVerts.resize(Constant::maxBatchSize);
+    batch.mIndices.resize(Constant::maxBatchSize);
+    batch.renderScale = Vec2(Constant::inverseWorldRatio, 1.0f);
+
+    Random random(seed);
+    std::vector<Transform> ts = MakeTransforms(random.generator);
+    std::vector<std::shared_ptr<Model>> models;
+    for(int i = 0; i < 40; ++i) {
+        models.push_back(i == 0 ? Model::CreateShip() : (i < 30 ? Model::CreateAsteroid(random) : Model::CreateBullet()));
+        models.back()->ApplyTransform(ts[i]);
+        batch.Add(models.back());
+    }
+
+    Measure(out, "Batch::PackVertices", 2000, NoSetup, [&](int) {
+        int vertSize, indSize;
+        batch.PackVertices(vertSize, indSize);
+        return static_cast<float>(vertSize + indSize);
+    });
+
+    UnifiedBatch unified;
+    Measure(out, "UnifiedBatch::Append", 2000, NoSetup, [&](int) {
+        int vertSize = 0, indSize = 0;
+        unified.Append(batch, vertSize, indSize);
+        return static_cast<float>(vertSize + indSize);
+    });
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Utils.h>
+
+//Микробенчмарки горячих функций геометрии и моделей
+//Входные данные строятся из фиксированных зерен, OpenGL не вызывается,
+//поэтому результаты сравнимы между запусками и собираются и на устройстве, и без экрана
+//(см. asteroids_benchmark в Headless.h и Constant::runBenchmarks)
+class Benchmark {
+public:
+    struct Result {
+        std::string name;
+        double nsPerOp;   //среднее по повторам
+        double stdDev;    //стандартное отклонение ns/op между повторами
+        int opsPerRepeat;
+        int repeats;
+    };
+
+    //filter - подстрока имени, пустая строка - все бенчмарки
+    static std::vector<Result> Run(const std::string& filter = "");
+    //{"benchmarks": [{"name": ..., "ns_per_op": ..., "stddev": ..., "ops": ..., "repeats": ...}, ...]}
+    static std::string ToJson(const std::vector<Result>& results);
+    static void Log(const std::vector<Result>& results);
+
+private:
+    static void SegmentCollision(std::vector<Result>& out);
+    static void MovingSegmentCollision(std::vector<Result>& out);
+    static void RefineCollision(std::vector<Result>& out);
+    static void ApplyTransform(std::vector<Result>& out);
+    static void CalcRadius(std::vector<Result>& out);
+    static void DefaultIndices(std::vector<Result>& out);
+    static void Split(std::vector<Result>& out);
+    static void CreateAsteroid(std::vector<Result>& out);
+    static void BatchPack(std::vector<Result>& out);
+};
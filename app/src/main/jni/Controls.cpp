@@ -1,36 +1,22 @@
 #include <Controls.h>
 #include <Game.h>
-
-float Controls::forward = 0.f;
-float Controls::horAxis = 0.f;
-bool Controls::shooting = false;
-bool Controls::teleporting = false;
+#include <AllocTracker.h>
 
 const int Controls::invalidId = -1;
-//Идентифицируем палец по кнопке, на которой началось касание
-int Controls::movementId = invalidId;
-int Controls::shootingId = invalidId;
-int Controls::teleportId = invalidId;
-int Controls::pauseId = invalidId;
-int Controls::resumeId = invalidId;
-int Controls::restartId = invalidId;
-
-std::unique_ptr<Controls::Button> Controls::fwd, Controls::left,
-    Controls::right, Controls::shoot, Controls::teleport,
-    Controls::pause, Controls::resume, Controls::restart;
-
-void Controls::Init() {
+
+Controls::Controls(Game& _game, Renderer& _renderer) : game(_game), renderer(_renderer) {
     //Создаём кнопки, по местам кнопки расставляются позже (см. Resize)
-    fwd = std::unique_ptr<Button>(new Button(Model::CreateTriangleBtn()));
-    left = std::unique_ptr<Button>(new Button(Model::CreateTriangleBtn(), M_PI / 2.0));
-    right = std::unique_ptr<Button>(new Button(Model::CreateTriangleBtn(), -M_PI / 2.0));
-    shoot = std::unique_ptr<Button>(new Button(Model::CreateShootBtn(), 0.f, Constant::largeButtonScale));
-    teleport = std::unique_ptr<Button>(new Button(Model::CreateTeleportBtn()));
-
-    pause = std::unique_ptr<Button>(new Button(Model::CreatePauseBtn(), 0.f, Constant::smallButtonScale));
-    resume = std::unique_ptr<Button>(new Button(Model::CreateTriangleBtn(), -M_PI / 2.0, Constant::smallButtonScale));
+    Batch& b = renderer.GetControlsBatch();
+    fwd = std::unique_ptr<Button>(new Button(b, Model::CreateTriangleBtn()));
+    left = std::unique_ptr<Button>(new Button(b, Model::CreateTriangleBtn(), M_PI / 2.0));
+    right = std::unique_ptr<Button>(new Button(b, Model::CreateTriangleBtn(), -M_PI / 2.0));
+    shoot = std::unique_ptr<Button>(new Button(b, Model::CreateShootBtn(), 0.f, Constant::largeButtonScale));
+    teleport = std::unique_ptr<Button>(new Button(b, Model::CreateTeleportBtn()));
+
+    pause = std::unique_ptr<Button>(new Button(b, Model::CreatePauseBtn(), 0.f, Constant::smallButtonScale));
+    resume = std::unique_ptr<Button>(new Button(b, Model::CreateTriangleBtn(), -M_PI / 2.0, Constant::smallButtonScale));
     resume->Disable();
-    restart = std::unique_ptr<Button>(new Button(Model::CreateRestartBtn(), 0.f, Constant::smallButtonScale));
+    restart = std::unique_ptr<Button>(new Button(b, Model::CreateRestartBtn(), 0.f, Constant::smallButtonScale));
     restart->Disable();
 }
 
@@ -47,7 +33,7 @@ void Controls::onResume() {
 }
 
 void Controls::Resize() {
-    float w = 1.0f / Renderer::GetHUDScale().x;
+    float w = 1.0f / renderer.GetHUDScale().x;
     float h = 1.0f;
     float distBB = Constant::buttonInterval * h;
     float dist = Constant::buttonMargin * h;
@@ -64,6 +50,8 @@ void Controls::Resize() {
 
 //Логика обработки нажатий в следующих трех функциях
 void Controls::onPointerDown(int id, float x, float y) {
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Input);
+    game.RequestRedraw();
     if(shoot->Inside(x, y)) {
         shootingId = id;
         shooting = true;
@@ -117,6 +105,8 @@ void Controls::onPointerDown(int id, float x, float y) {
 }
 
 void Controls::onPointerUp(int id, float x, float y) {
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Input);
+    game.RequestRedraw();
     if(id == movementId) {
         forward = 0.f;
         horAxis = 0.f;
@@ -135,23 +125,25 @@ void Controls::onPointerUp(int id, float x, float y) {
     }
     if((id == pauseId) && pause->Inside(x, y)) {
         pauseId = invalidId;
-        Game::Get().Pause();
+        game.Pause();
         return;
     }
     if((id == resumeId) && resume->Inside(x, y)) {
         resumeId = invalidId;
-        Game::Get().Resume();
+        game.Resume();
         return;
     }
     if((id == restartId) && restart->Inside(x, y)) {
         restartId = invalidId;
-        Game::Get().RequestRestart();
-        Game::Get().Resume();
+        game.RequestRestart();
+        game.Resume();
         return;
     }
 }
 
 void Controls::onPointerMove(int id, float x, float y) {
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Input);
+    game.RequestRedraw();
     if(id == movementId && forward > 0.f) {
         float pos = fwd->getPos().x;
         float rad = fwd->getRadius();
@@ -165,19 +157,26 @@ void Controls::onPointerMove(int id, float x, float y) {
     }
 }
 
+void Controls::SetInput(float _forward, float _horAxis, bool _shooting, bool _teleporting) {
+    forward = std::max(0.f, std::min(1.f, _forward));
+    horAxis = std::max(-1.f, std::min(1.f, _horAxis));
+    shooting = _shooting;
+    teleporting = _teleporting;
+}
+
 //Возвращаем посчитанные ранее значения
-float Controls::Forward() {
+float Controls::Forward() const {
     return forward;
 }
 
-float Controls::HorAxis() {
+float Controls::HorAxis() const {
     return horAxis;
 }
 
-bool Controls::Shooting() {
+bool Controls::Shooting() const {
     return shooting;
 }
 
-bool Controls::Teleport() {
+bool Controls::Teleport() const {
     return teleporting;
 }
\ No newline at end of file
@@ -3,23 +3,28 @@
 #include <Utils.h>
 #include <Renderer.h>
 
+class Game;
+
+//Состояние ввода одной игры
 class Controls {
     class Button {
+        Batch& batch;
         std::shared_ptr<Model> model;
         Transform t;
         bool enabled;
     public:
-        Button(std::shared_ptr<Model> _model,
+        Button(Batch& _batch,
+               std::shared_ptr<Model> _model,
                float angle = 0.0f,
                const Vec2& scale = Vec2(1.0f, 1.0f),
-               const Vec2& pos = Vec2()) : model(_model), t(pos, angle, scale) {
+               const Vec2& pos = Vec2()) : batch(_batch), model(_model), t(pos, angle, scale) {
             model->ApplyTransform(t);
-            Renderer::GetControlsBatch().Add(model);
+            batch.Add(model);
             Enable();
         };
 
         ~Button() {
-            Renderer::GetControlsBatch().Remove(model);
+            batch.Remove(model);
         };
 
         void Enable() {
@@ -57,28 +62,42 @@ class Controls {
 
     };
 
-    static float forward;
-    static float horAxis;
-    static bool shooting;
-    static bool teleporting;
+    Game& game;
+    Renderer& renderer;
+
+    float forward = 0.f;
+    float horAxis = 0.f;
+    bool shooting = false;
+    bool teleporting = false;
     static const int invalidId;
-    static int movementId, teleportId, shootingId, pauseId, resumeId, restartId;
+    //Идентифицируем палец по кнопке, на которой началось касание
+    int movementId = invalidId;
+    int teleportId = invalidId;
+    int shootingId = invalidId;
+    int pauseId = invalidId;
+    int resumeId = invalidId;
+    int restartId = invalidId;
 
-    static std::unique_ptr<Button> fwd, left, right, shoot, teleport, pause, resume, restart;
+    std::unique_ptr<Button> fwd, left, right, shoot, teleport, pause, resume, restart;
 
 public:
-    static void Init();
-    static void Resize();
+    Controls(Game& _game, Renderer& _renderer);
+    Controls(const Controls&) = delete;
+    Controls& operator=(const Controls&) = delete;
+
+    void Resize();
 
-    static void onPause();
-    static void onResume();
+    void onPause();
+    void onResume();
 
-    static void onPointerDown(int id, float x, float y);
-    static void onPointerUp(int id, float x, float y);
-    static void onPointerMove(int id, float x, float y);
+    void onPointerDown(int id, float x, float y);
+    void onPointerUp(int id, float x, float y);
+    void onPointerMove(int id, float x, float y);
+    //Управление без касаний (боты, игры без экрана), значения как у Forward/HorAxis
+    void SetInput(float _forward, float _horAxis, bool _shooting, bool _teleporting);
 
-    static float Forward();
-    static float HorAxis();
-    static bool Shooting();
-    static bool Teleport();
+    float Forward() const;
+    float HorAxis() const;
+    bool Shooting() const;
+    bool Teleport() const;
 };
\ No newline at end of file
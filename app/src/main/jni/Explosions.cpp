@@ -0,0 +1,187 @@
+#include <Explosions.h>
+
+///SpikeModel///
+
+SpikeModel::SpikeModel(int capacity) : Model(std::vector<GLfloat>(), std::vector<GLubyte>()) {
+    tverts.reserve(capacity * 4);
+    //Луч и линия к следующему лучу
+    indices.reserve(capacity * 4);
+}
+
+void SpikeModel::Clear() {
+    if(!tverts.empty()) changed = true;
+    tverts.clear();
+    indices.clear();
+}
+
+void SpikeModel::AddSpike(float x0, float y0, float x1, float y1) {
+    int i = tverts.size() / 2;
+    tverts.push_back(x0);
+    tverts.push_back(y0);
+    tverts.push_back(x1);
+    tverts.push_back(y1);
+    indices.push_back(i);
+    indices.push_back(i + 1);
+    changed = true;
+
+    if(i == 0) boundsMin = boundsMax = Vec2(x0, y0);
+    boundsMin = Vec2(std::min(boundsMin.x, std::min(x0, x1)), std::min(boundsMin.y, std::min(y0, y1)));
+    boundsMax = Vec2(std::max(boundsMax.x, std::max(x0, x1)), std::max(boundsMax.y, std::max(y0, y1)));
+    center = (boundsMin + boundsMax) / 2.f;
+    sqrRadius = boundsMax.getSquaredDist(center);
+    radius = sqrt(sqrRadius);
+}
+
+void SpikeModel::Link(int from, int to) {
+    indices.push_back(from * 2 + 1);
+    indices.push_back(to * 2);
+}
+
+
+///Explosions///
+
+constexpr int Explosions::spikesPerModel;
+constexpr int Explosions::modelCount;
+
+void Explosions::Init(Batch& _batch, Random& _random) {
+    batch = &_batch;
+    random = &_random;
+    for(int i = 0; i < modelCount; ++i) {
+        auto model = std::make_shared<SpikeModel>(spikesPerModel);
+        batch->Add(model);
+        models.push_back(model);
+    }
+}
+
+Explosions::~Explosions() {
+    for(auto& m : models) {
+        batch->Remove(m);
+    }
+}
+
+void Explosions::Spawn(const Vec2& pos) {
+    const int vertCount = Constant::explosionVertCount;
+    std::uniform_real_distribution<float> disp(Constant::explosionSpikeLen / 3, Constant::explosionSpikeLen);
+    std::uniform_real_distribution<float> shift(-Constant::asteroidAngleVariance, Constant::asteroidAngleVariance);
+
+    const int spikes = (vertCount + spikeStep - 1) / spikeStep;
+
+    //Нет места - вытесняем самые старые лучи, ровно столько, сколько не хватает
+    const int shortfall = count + spikes - capacity;
+    if(shortfall > 0) {
+        head = (head + shortfall) % capacity;
+        count -= shortfall;
+    }
+
+    //Лучи расходятся по кругу со случайным смещением (см. Model::CreateAsteroid)
+    float angles[vertCount], dists[vertCount], s[vertCount], c[vertCount];
+    for(int i = 0; i < vertCount; ++i) {
+        angles[i] = 2.0 * M_PI * i / vertCount + shift(random->generator);
+        dists[i] = disp(random->generator);
+    }
+    FastMath::SinCos(angles, s, c, vertCount);
+
+    for(int i = 0; i < vertCount; i += spikeStep) {
+        int k = (head + count) % capacity;
+        loopNext[k] = i + spikeStep < vertCount ? 1 : 1 - spikes;
+        spawnTime[k] = time;
+        originX[k] = pos.x;
+        originY[k] = pos.y;
+        innerX[k] = dists[i] * c[i];
+        innerY[k] = dists[i] * s[i];
+        outerX[k] = (dists[i] + Constant::explosionSpikeLen) * c[i];
+        outerY[k] = (dists[i] + Constant::explosionSpikeLen) * s[i];
+        count++;
+    }
+}
+
+void Explosions::Update(float dt) {
+    time += dt;
+    while(count > 0 && time - spawnTime[head] >= Constant::explosionLifetime) {
+        head = (head + 1) % capacity;
+        count--;
+    }
+}
+
+void Explosions::WriteModels(const Vec2& camera) {
+    for(auto& m : models) {
+        m->Clear();
+    }
+
+    //Квадратично увеличиваем масштаб в течение explosionLifetime секунд
+    const float invLifetime = 1.f / Constant::explosionLifetime;
+    size_t m = 0;
+    int runStart = 0; //Первый луч текущего взрыва в модели
+    for(int i = 0; i < count; ++i) {
+        int k = (head + i) % capacity;
+        bool newRun = i == 0 || loopNext[(k + capacity - 1) % capacity] <= 0;
+        if(newRun) {
+            //Взрыв целиком в одной модели, иначе ломаную не замкнуть
+            int len = 1;
+            while(i + len < count && loopNext[(k + len - 1) % capacity] > 0) len++;
+            if(models[m]->getSpikeCount() + len > spikesPerModel && ++m == models.size()) break;
+            runStart = models[m]->getSpikeCount();
+        } else if(models[m]->getSpikeCount() == spikesPerModel) {
+            //Испорченный снимок с слишком длинным взрывом - рвем ломаную
+            if(++m == models.size()) break;
+            runStart = 0;
+            newRun = true;
+        }
+
+        SpikeModel& model = *models[m];
+        float scale = 1 + sqrt((time - spawnTime[k]) * invLifetime) * Constant::explosionMaxScale;
+        Vec2 origin(originX[k], originY[k]);
+        if(Constant::largeWorld) origin = camera + Transform::WrapDelta(origin - camera);
+        model.AddSpike(origin.x + innerX[k] * scale, origin.y + innerY[k] * scale,
+                       origin.x + outerX[k] * scale, origin.y + outerY[k] * scale);
+        int j = model.getSpikeCount() - 1;
+        if(!newRun) model.Link(j - 1, j);
+        //Замыкаем, только если первый луч взрыва еще жив (голову могло вытеснить)
+        if(loopNext[k] < 0 && j + loopNext[k] >= runStart) model.Link(j, j + loopNext[k]);
+    }
+}
+
+void Explosions::Clear() {
+    head = 0;
+    count = 0;
+    WriteModels(Vec2());
+}
+
+void Explosions::Save(SnapshotWriter& w) const {
+    w.Put(time);
+    w.Put<int32_t>(count);
+    for(int i = 0; i < count; ++i) {
+        int k = (head + i) % capacity;
+        w.Put(spawnTime[k]);
+        w.Put(originX[k]);
+        w.Put(originY[k]);
+        w.Put(innerX[k]);
+        w.Put(innerY[k]);
+        w.Put(outerX[k]);
+        w.Put(outerY[k]);
+        w.Put(loopNext[k]);
+    }
+}
+
+bool Explosions::Load(SnapshotReader& r) {
+    int32_t n = 0;
+    Clear();
+    if(!r.Get(time) || !r.Get(n) || n < 0 || n > capacity) return false;
+    for(int k = 0; k < n; ++k) {
+        r.Get(spawnTime[k]);
+        r.Get(originX[k]);
+        r.Get(originY[k]);
+        r.Get(innerX[k]);
+        r.Get(innerY[k]);
+        r.Get(outerX[k]);
+        r.Get(outerY[k]);
+        r.Get(loopNext[k]);
+        if(loopNext[k] > 1 || loopNext[k] <= -Constant::explosionVertCount) r.Fail();
+    }
+    if(!r.isOk()) {
+        Clear();
+        return false;
+    }
+    count = n;
+    return true;
+}
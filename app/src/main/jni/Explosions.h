@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include <Renderer.h>
+#include <Snapshot.h>
+
+//Модель, вершины которой пишутся напрямую системой взрывов
+//Исходных вершин нет, только преобразованные: каждая пара вершин - внутренний и внешний конец луча.
+//Центр и радиус - по прямоугольнику, охватывающему все лучи (для отсечения в Batch::GetViewOffset)
+class SpikeModel : public Model {
+    Vec2 boundsMin, boundsMax;
+
+public:
+    explicit SpikeModel(int capacity);
+    //Память зарезервирована в конструкторе, поэтому перезапись модели не выделяет память
+    void Clear();
+    void AddSpike(float x0, float y0, float x1, float y1);
+    //Линия от внешнего конца луча from к внутреннему концу луча to
+    void Link(int from, int to);
+    int getSpikeCount() const {return tverts.size() / 4;};
+};
+
+//Система частиц для взрывов. Взрыв - это explosionVertCount лучей, разлетающихся из точки.
+//Лучи хранятся в кольцевом буфере фиксированной емкости в виде структуры массивов.
+//Время жизни у всех одинаковое, поэтому лучи умирают в порядке появления (с головы буфера).
+//Если буфер заполнен, новый взрыв вытесняет самый старый.
+//Лучи одного взрыва соединены замкнутой ломаной "звездой", как в Model::DefaultIndices
+class Explosions {
+    static constexpr int capacity = Constant::explosionMaxCount * Constant::explosionVertCount;
+    //Лучей в одной модели, чтобы индексы GLubyte не переполнялись
+    static constexpr int spikesPerModel = 64;
+    //Взрыв не разрывается между моделями, поэтому в модели может пустовать до explosionVertCount - 1 лучей
+    static constexpr int modelCount = (capacity + spikesPerModel - Constant::explosionVertCount) /
+                                      (spikesPerModel - Constant::explosionVertCount + 1);
+
+    std::array<float, capacity> spawnTime;
+    std::array<float, capacity> originX, originY;
+    //Концы луча относительно центра взрыва при масштабе 1
+    std::array<float, capacity> innerX, innerY;
+    std::array<float, capacity> outerX, outerY;
+    //Смещение до следующего луча ломаной: 1 внутри взрыва, у последнего - назад к первому
+    std::array<int8_t, capacity> loopNext;
+    int head = 0;
+    int count = 0;
+    float time = 0.f;
+    //Из лучей взрыва сохраняется каждый spikeStep-й (см. QualityGovernor)
+    int spikeStep = 1;
+
+    std::vector<std::shared_ptr<SpikeModel>> models;
+    Batch* batch = nullptr;
+    Random* random = nullptr;
+
+public:
+    //Модели добавляются в batch, случайные величины берутся из random
+    void Init(Batch& _batch, Random& _random);
+    ~Explosions();
+
+    void Spawn(const Vec2& pos);
+    //Старит лучи и убирает умершие
+    void Update(float dt);
+    //Пишет живые лучи в модели. Вызывается после всех Spawn кадра, чтобы новые взрывы
+    //и вытесненные лучи попали в тот же кадр. В большом мире каждый луч переносится
+    //к ближайшей к camera копии на торе
+    void WriteModels(const Vec2& camera);
+    void Clear();
+    bool isActive() const {return count > 0;};
+    //Новые взрывы - с каждым step-м лучом. Случайные величины берутся для всех лучей,
+    //поэтому последовательность Random от этого не зависит
+    void setSpikeStep(int step) {spikeStep = std::max(1, step);};
+
+    //Живые лучи в порядке появления. Load модели не пишет: камера восстанавливается позже
+    void Save(SnapshotWriter& w) const;
+    bool Load(SnapshotReader& r);
+};
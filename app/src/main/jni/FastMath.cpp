@@ -0,0 +1,31 @@
+#include <FastMath.h>
+#include <Utils.h>
+
+int FastMath::CheckAccuracy() {
+    const int samples = 200000;
+    const float range = 1000.f;
+    float errHigh = 0.f, errLow = 0.f, errAtan = 0.f;
+    for(int i = 0; i <= samples; ++i) {
+        float x = -range + 2.f * range * i / samples;
+        float s, c;
+        SinCos<Precision::High>(x, s, c);
+        errHigh = std::fmax(errHigh, std::fmax(std::fabs(s - std::sin(x)), std::fabs(c - std::cos(x))));
+        SinCos<Precision::Low>(x, s, c);
+        errLow = std::fmax(errLow, std::fmax(std::fabs(s - std::sin(x)), std::fabs(c - std::cos(x))));
+
+        float a = 2.f * pi * i / samples;
+        float y = std::sin(a), z = std::cos(a);
+        errAtan = std::fmax(errAtan, std::fabs(Atan2(y, z) - std::atan2(y, z)));
+    }
+
+    //Границы из описания в FastMath.h
+    int failed = 0;
+    auto check = [&failed](const char* name, float err, float bound) {
+        LOGI("FastMath check %s: %s (max error %.3g, bound %.3g)", name, err <= bound ? "ok" : "FAILED", err, bound);
+        if(!(err <= bound)) failed++;
+    };
+    check("sincos high", errHigh, 2e-7f);
+    check("sincos low", errLow, 4e-5f);
+    check("atan2", errAtan, 2e-6f);
+    return failed;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cmath>
+
+//Быстрые синус, косинус и арктангенс для горячих мест (Transform::setAngle, построение моделей).
+//Аргумент приводится к [-pi/4, pi/4] (x = q*pi/2 + r), далее полином по r.
+//Абсолютная погрешность относительно libm для |x| <= 1000 (см. FastMath::CheckAccuracy):
+//  Precision::High - многочлены Cephes sinf/cosf, не больше 2e-7
+//  Precision::Low  - на один член короче, не больше 4e-5
+//  Atan2           - не больше 2e-6 рад
+namespace FastMath {
+    //false - все функции вызывают libm (для проверки точности)
+    static constexpr bool enabled = true;
+
+    enum class Precision {Low, High};
+
+    static constexpr float pi = 3.14159265358979f;
+    static constexpr float halfPi = 1.57079632679490f;
+    static constexpr float twoOverPi = 0.63661977236758f;
+    //pi/2 в виде суммы для точного вычитания (Cody-Waite)
+    static constexpr float halfPiHi = 1.5703125f;
+    static constexpr float halfPiMid = 4.837512969970703125e-4f;
+    static constexpr float halfPiLo = 7.54978995489188216e-8f;
+
+    //Полиномы на [-pi/4, pi/4]
+    template <Precision P>
+    inline float SinPoly(float r) {
+        float r2 = r * r;
+        if(P == Precision::High) {
+            return r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+        } else {
+            return r + r * r2 * (-1.6665853e-1f + r2 * 8.3086124e-3f);
+        }
+    }
+
+    template <Precision P>
+    inline float CosPoly(float r) {
+        float r2 = r * r;
+        if(P == Precision::High) {
+            return 1.f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+        } else {
+            return 1.f - 0.5f * r2 + r2 * r2 * (4.1632894e-2f + r2 * -1.3345686e-3f);
+        }
+    }
+
+    //Синус и косинус за одно приведение аргумента
+    template <Precision P = Precision::High>
+    inline void SinCos(float x, float& s, float& c) {
+        if(!enabled) {
+            s = std::sin(x);
+            c = std::cos(x);
+            return;
+        }
+        float qf = std::floor(x * twoOverPi + 0.5f);
+        int q = static_cast<int>(qf);
+        float r = ((x - qf * halfPiHi) - qf * halfPiMid) - qf * halfPiLo;
+        float ps = SinPoly<P>(r);
+        float pc = CosPoly<P>(r);
+        //Поворот на q четвертей
+        float ss = (q & 1) ? pc : ps;
+        float cc = (q & 1) ? ps : pc;
+        s = (q & 2) ? -ss : ss;
+        c = ((q + 1) & 2) ? -cc : cc;
+    }
+
+    template <Precision P = Precision::High>
+    inline float Sin(float x) {
+        float s, c;
+        SinCos<P>(x, s, c);
+        return s;
+    }
+
+    template <Precision P = Precision::High>
+    inline float Cos(float x) {
+        float s, c;
+        SinCos<P>(x, s, c);
+        return c;
+    }
+
+    //Пакетный вариант без ветвлений внутри цикла, векторизуется компилятором (NEON/SSE)
+    template <Precision P = Precision::High>
+    inline void SinCos(const float* x, float* s, float* c, int n) {
+        if(!enabled) {
+            for(int i = 0; i < n; ++i) {
+                s[i] = std::sin(x[i]);
+                c[i] = std::cos(x[i]);
+            }
+            return;
+        }
+        for(int i = 0; i < n; ++i) {
+            float qf = std::floor(x[i] * twoOverPi + 0.5f);
+            int q = static_cast<int>(qf);
+            float r = ((x[i] - qf * halfPiHi) - qf * halfPiMid) - qf * halfPiLo;
+            float ps = SinPoly<P>(r);
+            float pc = CosPoly<P>(r);
+            float swap = static_cast<float>(q & 1);
+            float ss = ps + (pc - ps) * swap;
+            float cc = pc + (ps - pc) * swap;
+            s[i] = ss * (1.f - static_cast<float>(q & 2));
+            c[i] = cc * (1.f - static_cast<float>((q + 1) & 2));
+        }
+    }
+
+    //Угол вектора (y, x), как std::atan2
+    inline float Atan2(float y, float x) {
+        if(!enabled) return std::atan2(y, x);
+        float ax = std::fabs(x), ay = std::fabs(y);
+        float mx = std::fmax(ax, ay);
+        if(mx == 0.f) return 0.f;
+        //atan на [0, 1], минимакс-полином по t^2
+        float t = std::fmin(ax, ay) / mx;
+        float t2 = t * t;
+        float a = t * (0.99997726f + t2 * (-0.33262347f + t2 * (0.19354346f + t2 * (-0.11643287f + t2 * (0.05265332f + t2 * -0.01172120f)))));
+        if(ay > ax) a = halfPi - a;
+        if(x < 0.f) a = pi - a;
+        return y < 0.f ? -a : a;
+    }
+
+    //Сравнивает с libm на равномерной сетке, максимальная погрешность в лог.
+    //Возвращает число функций, превысивших заявленную границу (см. asteroids_check_fast_math)
+    int CheckAccuracy();
+};
@@ -0,0 +1,53 @@
+#include <FrameArena.h>
+
+///FrameArena///
+
+FrameArena::FrameArena(size_t capacity) {
+    AddBlock(capacity);
+}
+
+void FrameArena::AddBlock(size_t size) {
+    Block b;
+    b.data.reset(new unsigned char[size]);
+    b.size = size;
+    blocks.push_back(std::move(b));
+}
+
+void* FrameArena::Allocate(size_t size, size_t align) {
+    for(;;) {
+        Block& b = blocks[curBlock];
+        size_t start = (offset + align - 1) & ~(align - 1);
+        if(start + size <= b.size) {
+            offset = start + size;
+            used += size;
+            return b.data.get() + start;
+        }
+        //Не поместилось - следующий блок, при необходимости новый, не меньше вдвое
+        curBlock++;
+        offset = 0;
+        if(curBlock == blocks.size()) {
+            AddBlock(std::max(size + align, blocks.back().size * 2));
+        }
+    }
+}
+
+void FrameArena::Reset() {
+    peak = std::max(peak, used);
+    if(blocks.size() > 1) {
+        size_t total = getCapacity();
+        blocks.clear();
+        AddBlock(total);
+    }
+    curBlock = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t FrameArena::getCapacity() const {
+    size_t total = 0;
+    for(auto& b : blocks) {
+        total += b.size;
+    }
+    return total;
+}
+
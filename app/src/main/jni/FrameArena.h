@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <Utils.h>
+
+//Линейный распределитель для данных, живущих не дольше одного шага игры
+//Память выдается сдвигом указателя, освобождается вся разом в Reset (см. Game::Step)
+//Если блока не хватило, берется новый, а после Reset блоки сливаются в один,
+//так что в установившемся режиме куча не используется
+class FrameArena {
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t curBlock = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t peak = 0;
+
+    void AddBlock(size_t size);
+
+public:
+    explicit FrameArena(size_t capacity = Constant::frameArenaSize);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t size, size_t align);
+    void Reset();
+
+    //Максимальный объем за шаг, байт
+    size_t getPeak() const {return peak;};
+    size_t getCapacity() const;
+};
+
+//Адаптер для контейнеров STL. deallocate ничего не делает
+template <class T>
+class FrameAllocator {
+    template <class U> friend class FrameAllocator;
+    FrameArena* arena;
+
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <class U> struct rebind { typedef FrameAllocator<U> other; };
+
+    explicit FrameAllocator(FrameArena& _arena) : arena(&_arena) {};
+    template <class U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {};
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+    };
+    void deallocate(T*, size_t) {};
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    };
+    template <class U>
+    void destroy(U* p) {
+        p->~U();
+    };
+    size_t max_size() const {return size_t(-1) / sizeof(T);};
+
+    template <class U>
+    bool operator==(const FrameAllocator<U>& other) const {return arena == other.arena;};
+    template <class U>
+    bool operator!=(const FrameAllocator<U>& other) const {return arena != other.arena;};
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template <class K, class V>
+using FrameMap = std::map<K, V, std::less<K>, FrameAllocator<std::pair<const K, V>>>;
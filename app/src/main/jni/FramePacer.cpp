@@ -0,0 +1,109 @@
+#include <FramePacer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+long long FramePacer::Now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void FramePacer::SetRefreshRate(float hz) {
+    if(hz < 1.0f) return;
+    period = static_cast<long long>(1e9f / hz);
+    LOGI("Display refresh %.2f Hz", hz);
+}
+
+float FramePacer::OnFrame(long long vsyncNs, long long nowNs, float frameInterval) {
+    //Callback Choreographer мог еще не прийти (поток GL обогнал главный поток или
+    //отрисовка была остановлена) - переносим vsync вперед на целое число периодов
+    long long vsync = vsyncNs;
+    if(nowNs > vsync) vsync += (nowNs - vsync) / period * period;
+
+    //Кадры за один vsync уходят в очередь и будут показаны на следующих
+    long long periods = 1;
+    if(lastVsync != 0) {
+        vsync = std::max(vsync, lastVsync + period);
+        periods = (vsync - lastVsync + period / 2) / period;
+    }
+    const long long expected = std::max(1LL, std::llround(frameInterval * 1e9f / period));
+    if(lastVsync != 0 && periods > expected) {
+        dropped += static_cast<int>(periods - expected);
+        totalDropped += periods - expected;
+    }
+    if(nowNs - vsync > period * Constant::lateFrameRatio) late++;
+    lastVsync = vsync;
+
+    const long long prevPresent = presentTime;
+    presentTime = vsync + period * Constant::presentLatencyFrames;
+    if(++frames >= Constant::jankReportFrames) Report();
+    return prevPresent != 0 ? (presentTime - prevPresent) / 1e9f : getPeriod();
+}
+
+void FramePacer::Report() {
+    LOGI("Frames %d, dropped %d (%.1f%%), late %d, refresh period %.2f ms",
+         frames, dropped, 100.0f * dropped / (frames + dropped), late, period / 1e6f);
+    frames = dropped = late = 0;
+}
+
+int FramePacer::SelfCheck() {
+    const long long p = 16666667;
+    int failed = 0;
+    auto check = [&failed](const char* name, bool ok, long long dropped, float dt) {
+        LOGI("FramePacer check %s: %s (dropped %lld, dt %.2f ms)", name, ok ? "ok" : "FAILED", dropped, dt * 1000.0f);
+        if(!ok) failed++;
+    };
+
+    //Ровный поток с разбросом начала отрисовки и отстающим callback Choreographer
+    {
+        FramePacer pacer;
+        long long v = 1000000000LL;
+        bool ok = true;
+        float dt = 0.0f;
+        for(int i = 0; i < 120; ++i) {
+            v += p;
+            dt = pacer.OnFrame(i % 7 == 3 ? v - p : v, v + (i * 1237) % 5000000, 0.0f);
+            ok = ok && std::fabs(dt - p / 1e9f) < 1e-5f;
+        }
+        check("steady", ok && pacer.getDroppedFrames() == 0, pacer.getDroppedFrames(), dt);
+    }
+    //Один пропущенный vsync - один потерянный кадр и шаг в два периода
+    {
+        FramePacer pacer;
+        long long v = 1000000000LL;
+        for(int i = 0; i < 10; ++i) {
+            v += p;
+            pacer.OnFrame(v, v, 0.0f);
+        }
+        v += 2 * p;
+        const float dt = pacer.OnFrame(v, v, 0.0f);
+        check("skip", pacer.getDroppedFrames() == 1 && std::fabs(dt - 2 * p / 1e9f) < 1e-5f, pacer.getDroppedFrames(), dt);
+    }
+    //Перерыв (пауза, неподвижный кадр): Game сбрасывает FramePacer, а первый кадр после
+    //перерыва может прийти со старым vsync - это не потерянные кадры
+    {
+        FramePacer pacer;
+        long long v = 1000000000LL;
+        for(int i = 0; i < 10; ++i) {
+            v += p;
+            pacer.OnFrame(v, v, 0.0f);
+        }
+        pacer.Reset();
+        const float dt = pacer.OnFrame(v, v + 10000000000LL, 0.0f);
+        check("idle gap", pacer.getDroppedFrames() == 0 && std::fabs(dt - p / 1e9f) < 1e-5f, pacer.getDroppedFrames(), dt);
+    }
+    //Ограничение частоты: кадр на каждый второй vsync - не пропуски
+    {
+        FramePacer pacer;
+        long long v = 1000000000LL;
+        float dt = 0.0f;
+        for(int i = 0; i < 60; ++i) {
+            v += 2 * p;
+            dt = pacer.OnFrame(v, v, 1.0f / 30.0f);
+        }
+        check("capped", pacer.getDroppedFrames() == 0, pacer.getDroppedFrames(), dt);
+    }
+    return failed;
+}
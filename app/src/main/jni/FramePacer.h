@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Utils.h>
+
+//Шаг симуляции по времени vsync вместо времени вызова onDrawFrame
+//Кадр будет показан примерно через Constant::presentLatencyFrames периодов после vsync,
+//с которого началась его отрисовка, поэтому шаг - разница предсказанных времен показа,
+//кратная периоду обновления экрана. Пропуски vsync считаются как потерянные кадры
+//Время в наносекундах по CLOCK_MONOTONIC, как System.nanoTime() и Choreographer в Java
+class FramePacer {
+    long long period = static_cast<long long>(1e9f / Constant::defaultRefreshRate);
+    long long lastVsync = 0;    //vsync последнего кадра, 0 - кадров еще не было
+    long long presentTime = 0;
+
+    //Счетчики для лога, сбрасываются каждые Constant::jankReportFrames кадров
+    int frames = 0;
+    int dropped = 0;
+    int late = 0;
+    long long totalDropped = 0;
+
+    void Report();
+
+public:
+    static long long Now();
+    //Проверка на синтетических vsync (ровный поток, пропуск, перерыв, ограничение частоты)
+    //Результаты в лог, возвращает число проваленных случаев (см. asteroids_check_frame_pacing)
+    static int SelfCheck();
+
+    void SetRefreshRate(float hz);
+    //Следующий кадр не продолжает предыдущий (пауза, загрузка), его шаг - один период
+    void Reset() {lastVsync = presentTime = 0;};
+    //vsyncNs - время последнего известного vsync, может отставать от nowNs на несколько периодов
+    //frameInterval - ожидаемый период кадра при ограничении частоты (см. Game::GetFrameInterval)
+    //Возвращает шаг симуляции в секундах
+    float OnFrame(long long vsyncNs, long long nowNs, float frameInterval);
+
+    //Предсказанное время показа текущего кадра
+    long long getPresentTime() const {return presentTime;};
+    float getPeriod() const {return period / 1e9f;};
+    long long getDroppedFrames() const {return totalDropped;};
+};
@@ -0,0 +1,537 @@
+#define GLTRACE_NO_REDIRECT
+#include <GLTrace.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+    using GLTrace::Op;
+    constexpr int opCount = static_cast<int>(Op::DisableVertexAttribArray) + 1;
+    const char* const opNames[opCount] = {
+        "EndFrame",
+        "glAttachShader", "glBindBuffer", "glBlendFunc", "glBufferData", "glBufferSubData", "glClear",
+        "glClearColor", "glCompileShader", "glCreateProgram", "glCreateShader", "glDeleteProgram",
+        "glDepthMask", "glDisable", "glDrawElements", "glEnable", "glEnableVertexAttribArray",
+        "glGenBuffers", "glGetAttribLocation", "glGetUniformLocation", "glLineWidth", "glLinkProgram",
+        "glShaderSource", "glUniform1f", "glUniform2f", "glUniform3f", "glUseProgram",
+        "glVertexAttribPointer", "glViewport",
+        "glBindFramebuffer", "glBindTexture", "glDrawArrays", "glFramebufferTexture2D", "glGenFramebuffers",
+        "glGenTextures", "glTexImage2D", "glTexParameteri",
+        "glDisableVertexAttribArray"
+    };
+
+    struct Counters {
+        uint64_t calls = 0;
+        uint64_t draws = 0;
+        uint64_t indices = 0;
+        uint64_t uploadBytes = 0;
+        uint64_t stateChanges = 0;
+        uint64_t redundant = 0;
+        uint64_t opRedundant[opCount] = {};
+    };
+
+    //Последнее установленное значение. До первой установки в новом контексте неизвестно
+    template<class T>
+    struct Shadow {
+        bool valid = false;
+        T value{};
+    };
+
+    //Копия состояния контекста, по ней видно, что вызов ничего не меняет
+    struct State {
+        Shadow<GLuint> program;
+        Shadow<GLuint> framebuffer;
+        //Только текстурный блок 0
+        std::map<GLenum, Shadow<GLuint>> textures;
+        std::map<GLenum, Shadow<GLuint>> buffers;
+        std::map<GLenum, Shadow<bool>> caps;
+        std::map<GLuint, Shadow<bool>> attribArrays;
+        //Ключ - программа и расположение переменной
+        std::map<std::pair<GLuint, GLint>, Shadow<std::array<GLfloat, 3>>> uniforms;
+        Shadow<std::array<GLenum, 2>> blend;
+        Shadow<std::array<GLfloat, 4>> clearColor;
+        Shadow<std::array<GLint, 4>> viewport;
+        Shadow<GLboolean> depthMask;
+        Shadow<GLfloat> lineWidth;
+    };
+
+    State state;
+    Counters window;
+    int windowFrames = 0;
+
+    std::string capturePath;
+    FILE* captureFile = nullptr;
+    int captureFramesLeft = 0;
+    bool captureDone = false;
+
+    template<class T>
+    void SetState(Shadow<T>& s, const T& value, Op op) {
+        if(!Constant::glTrace) return;
+        window.stateChanges++;
+        if(s.valid && s.value == value) {
+            window.redundant++;
+            window.opRedundant[static_cast<int>(op)]++;
+        }
+        s.valid = true;
+        s.value = value;
+    }
+
+    void Count() {
+        if(Constant::glTrace) window.calls++;
+    }
+
+    void CheckErrors(const char* name) {
+        if(!Constant::glCheckErrors) return;
+        //Ошибок может накопиться несколько, glGetError возвращает по одной
+        for(GLenum err = glGetError(); err != GL_NO_ERROR; err = glGetError()) {
+            LOGW("GL error 0x%04x after %s", err, name);
+        }
+    }
+
+    //Команда потока записи. Аргументы копируются в буфер, в файл пишутся в деструкторе
+    class Command {
+        static std::vector<char> payload;
+        Op op;
+        bool active;
+
+        void Append(const void* data, size_t size) {
+            const char* p = static_cast<const char*>(data);
+            payload.insert(payload.end(), p, p + size);
+        }
+
+    public:
+        explicit Command(Op _op) : op(_op), active(Constant::glCapture && captureFile) {
+            if(active) payload.clear();
+        }
+
+        ~Command() {
+            if(!active) return;
+            uint32_t head[2] = {static_cast<uint32_t>(op), static_cast<uint32_t>(payload.size())};
+            fwrite(head, sizeof(head), 1, captureFile);
+            if(!payload.empty()) fwrite(payload.data(), 1, payload.size(), captureFile);
+        }
+
+        Command(const Command&) = delete;
+        Command& operator=(const Command&) = delete;
+
+        //4 байта: GLenum, GLuint, GLint, GLfloat, GLboolean
+        template<class T>
+        Command& operator<<(T value) {
+            static_assert(sizeof(T) <= 4, "Use Size() for pointer-sized values");
+            if(!active) return *this;
+            uint32_t v = 0;
+            memcpy(&v, &value, sizeof(T));
+            Append(&v, sizeof(v));
+            return *this;
+        }
+
+        //8 байт: размеры, смещения в буфере
+        Command& Size(uint64_t value) {
+            if(active) Append(&value, sizeof(value));
+            return *this;
+        }
+
+        //Длина и данные
+        Command& Bytes(const void* data, size_t size) {
+            if(!active) return *this;
+            *this << static_cast<uint32_t>(size);
+            Append(data, size);
+            return *this;
+        }
+    };
+
+    std::vector<char> Command::payload;
+
+    void StopCapture() {
+        if(!captureFile) return;
+        fclose(captureFile);
+        captureFile = nullptr;
+        captureDone = true;
+        LOGI("GL capture written to %s", capturePath.c_str());
+    }
+
+    void Report() {
+        double frames = windowFrames;
+        LOGI("GL over %d frames: %.1f calls, %.1f draws, %.0f indices, %.0f B uploaded per frame",
+             windowFrames, window.calls / frames, window.draws / frames,
+             window.indices / frames, window.uploadBytes / frames);
+        LOGI("  %.1f state changes per frame, %.1f redundant", window.stateChanges / frames, window.redundant / frames);
+        for(int i = 0; i < opCount; ++i) {
+            if(window.opRedundant[i]) LOGI("  %-26s %.2f redundant/frame", opNames[i], window.opRedundant[i] / frames);
+        }
+        window = Counters();
+        windowFrames = 0;
+    }
+}
+
+
+void GLTrace::SetCapturePath(const std::string& path) {
+    capturePath = path;
+}
+
+void GLTrace::OnContextCreated() {
+    state = State();
+    if(!Constant::glCapture) return;
+    //Поток описывает один контекст: если его пересоздали посреди записи, запись обрывается
+    if(captureFile) {
+        LOGW("GL context recreated during capture");
+        StopCapture();
+    }
+    if(captureDone || capturePath.empty()) return;
+    captureFile = fopen(capturePath.c_str(), "wb");
+    if(!captureFile) {
+        LOGW("Can't open %s for GL capture", capturePath.c_str());
+        return;
+    }
+    uint32_t header[2] = {captureMagic, captureVersion};
+    fwrite(header, sizeof(header), 1, captureFile);
+    captureFramesLeft = Constant::glCaptureFrames;
+}
+
+void GLTrace::EndFrame() {
+    if(Constant::glCapture && captureFile) {
+        Command{Op::EndFrame};
+        if(--captureFramesLeft <= 0) StopCapture();
+    }
+    if(Constant::glTrace && ++windowFrames >= Constant::glTraceFrames) Report();
+}
+
+
+///Перехваченные вызовы///
+
+void GLTrace::AttachShader(GLuint program, GLuint shader) {
+    Count();
+    glAttachShader(program, shader);
+    CheckErrors("glAttachShader");
+    Command(Op::AttachShader) << program << shader;
+}
+
+void GLTrace::BindBuffer(GLenum target, GLuint buffer) {
+    Count();
+    SetState(state.buffers[target], buffer, Op::BindBuffer);
+    glBindBuffer(target, buffer);
+    CheckErrors("glBindBuffer");
+    Command(Op::BindBuffer) << target << buffer;
+}
+
+void GLTrace::BlendFunc(GLenum sfactor, GLenum dfactor) {
+    Count();
+    SetState(state.blend, {{sfactor, dfactor}}, Op::BlendFunc);
+    glBlendFunc(sfactor, dfactor);
+    CheckErrors("glBlendFunc");
+    Command(Op::BlendFunc) << sfactor << dfactor;
+}
+
+void GLTrace::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    Count();
+    if(Constant::glTrace && data) window.uploadBytes += size;
+    glBufferData(target, size, data, usage);
+    CheckErrors("glBufferData");
+    //Без данных (выделение памяти) пишется пустой блок
+    (Command(Op::BufferData) << target).Size(size).Bytes(data, data ? size : 0) << usage;
+}
+
+void GLTrace::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    Count();
+    if(Constant::glTrace) window.uploadBytes += size;
+    glBufferSubData(target, offset, size, data);
+    CheckErrors("glBufferSubData");
+    (Command(Op::BufferSubData) << target).Size(offset).Bytes(data, size);
+}
+
+void GLTrace::Clear(GLbitfield mask) {
+    Count();
+    glClear(mask);
+    CheckErrors("glClear");
+    Command(Op::Clear) << mask;
+}
+
+void GLTrace::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    Count();
+    SetState(state.clearColor, {{r, g, b, a}}, Op::ClearColor);
+    glClearColor(r, g, b, a);
+    CheckErrors("glClearColor");
+    Command(Op::ClearColor) << r << g << b << a;
+}
+
+void GLTrace::CompileShader(GLuint shader) {
+    Count();
+    glCompileShader(shader);
+    CheckErrors("glCompileShader");
+    Command(Op::CompileShader) << shader;
+}
+
+GLuint GLTrace::CreateProgram() {
+    Count();
+    GLuint program = glCreateProgram();
+    CheckErrors("glCreateProgram");
+    Command(Op::CreateProgram) << program;
+    return program;
+}
+
+GLuint GLTrace::CreateShader(GLenum type) {
+    Count();
+    GLuint shader = glCreateShader(type);
+    CheckErrors("glCreateShader");
+    Command(Op::CreateShader) << type << shader;
+    return shader;
+}
+
+void GLTrace::DeleteProgram(GLuint program) {
+    Count();
+    //Имя может достаться новой программе, ее переменные еще не заданы
+    auto first = state.uniforms.lower_bound({program, INT32_MIN});
+    auto last = state.uniforms.upper_bound({program, INT32_MAX});
+    state.uniforms.erase(first, last);
+    if(state.program.valid && state.program.value == program) state.program.valid = false;
+    glDeleteProgram(program);
+    CheckErrors("glDeleteProgram");
+    Command(Op::DeleteProgram) << program;
+}
+
+void GLTrace::DepthMask(GLboolean flag) {
+    Count();
+    SetState(state.depthMask, flag, Op::DepthMask);
+    glDepthMask(flag);
+    CheckErrors("glDepthMask");
+    Command(Op::DepthMask) << flag;
+}
+
+void GLTrace::Disable(GLenum cap) {
+    Count();
+    SetState(state.caps[cap], false, Op::Disable);
+    glDisable(cap);
+    CheckErrors("glDisable");
+    Command(Op::Disable) << cap;
+}
+
+void GLTrace::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    Count();
+    if(Constant::glTrace) {
+        window.draws++;
+        window.indices += count;
+    }
+    glDrawElements(mode, count, type, indices);
+    CheckErrors("glDrawElements");
+    //Индексы всегда в GL_ELEMENT_ARRAY_BUFFER, указатель - смещение в нем
+    (Command(Op::DrawElements) << mode << count << type).Size(reinterpret_cast<uintptr_t>(indices));
+}
+
+void GLTrace::Enable(GLenum cap) {
+    Count();
+    SetState(state.caps[cap], true, Op::Enable);
+    glEnable(cap);
+    CheckErrors("glEnable");
+    Command(Op::Enable) << cap;
+}
+
+void GLTrace::EnableVertexAttribArray(GLuint index) {
+    Count();
+    SetState(state.attribArrays[index], true, Op::EnableVertexAttribArray);
+    glEnableVertexAttribArray(index);
+    CheckErrors("glEnableVertexAttribArray");
+    Command(Op::EnableVertexAttribArray) << index;
+}
+
+void GLTrace::GenBuffers(GLsizei n, GLuint* buffers) {
+    Count();
+    glGenBuffers(n, buffers);
+    CheckErrors("glGenBuffers");
+    Command cmd(Op::GenBuffers);
+    cmd << n;
+    for(GLsizei i = 0; i < n; ++i) cmd << buffers[i];
+}
+
+GLint GLTrace::GetAttribLocation(GLuint program, const GLchar* name) {
+    Count();
+    GLint loc = glGetAttribLocation(program, name);
+    CheckErrors("glGetAttribLocation");
+    (Command(Op::GetAttribLocation) << program).Bytes(name, strlen(name)) << loc;
+    return loc;
+}
+
+//Запросы без побочных эффектов в поток не пишутся
+void GLTrace::GetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    Count();
+    glGetProgramiv(program, pname, params);
+    CheckErrors("glGetProgramiv");
+}
+
+const GLubyte* GLTrace::GetString(GLenum name) {
+    Count();
+    const GLubyte* str = glGetString(name);
+    CheckErrors("glGetString");
+    return str;
+}
+
+GLint GLTrace::GetUniformLocation(GLuint program, const GLchar* name) {
+    Count();
+    GLint loc = glGetUniformLocation(program, name);
+    CheckErrors("glGetUniformLocation");
+    (Command(Op::GetUniformLocation) << program).Bytes(name, strlen(name)) << loc;
+    return loc;
+}
+
+void GLTrace::LineWidth(GLfloat width) {
+    Count();
+    SetState(state.lineWidth, width, Op::LineWidth);
+    glLineWidth(width);
+    CheckErrors("glLineWidth");
+    Command(Op::LineWidth) << width;
+}
+
+void GLTrace::LinkProgram(GLuint program) {
+    Count();
+    //После линковки переменные программы сбрасываются
+    auto first = state.uniforms.lower_bound({program, INT32_MIN});
+    auto last = state.uniforms.upper_bound({program, INT32_MAX});
+    state.uniforms.erase(first, last);
+    glLinkProgram(program);
+    CheckErrors("glLinkProgram");
+    Command(Op::LinkProgram) << program;
+}
+
+void GLTrace::ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+    Count();
+    glShaderSource(shader, count, string, length);
+    CheckErrors("glShaderSource");
+    Command cmd(Op::ShaderSource);
+    cmd << shader << count;
+    for(GLsizei i = 0; i < count; ++i) {
+        cmd.Bytes(string[i], length && length[i] >= 0 ? length[i] : strlen(string[i]));
+    }
+}
+
+void GLTrace::Uniform1f(GLint location, GLfloat v0) {
+    Count();
+    SetState(state.uniforms[{state.program.value, location}], {{v0, 0.0f, 0.0f}}, Op::Uniform1f);
+    glUniform1f(location, v0);
+    CheckErrors("glUniform1f");
+    Command(Op::Uniform1f) << location << v0;
+}
+
+void GLTrace::Uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    Count();
+    SetState(state.uniforms[{state.program.value, location}], {{v0, v1, 0.0f}}, Op::Uniform2f);
+    glUniform2f(location, v0, v1);
+    CheckErrors("glUniform2f");
+    Command(Op::Uniform2f) << location << v0 << v1;
+}
+
+void GLTrace::Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    Count();
+    SetState(state.uniforms[{state.program.value, location}], {{v0, v1, v2}}, Op::Uniform3f);
+    glUniform3f(location, v0, v1, v2);
+    CheckErrors("glUniform3f");
+    Command(Op::Uniform3f) << location << v0 << v1 << v2;
+}
+
+void GLTrace::UseProgram(GLuint program) {
+    Count();
+    SetState(state.program, program, Op::UseProgram);
+    glUseProgram(program);
+    CheckErrors("glUseProgram");
+    Command(Op::UseProgram) << program;
+}
+
+void GLTrace::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                  GLsizei stride, const void* pointer) {
+    Count();
+    if(Constant::glTrace) window.stateChanges++;
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    CheckErrors("glVertexAttribPointer");
+    //Атрибуты всегда из GL_ARRAY_BUFFER, указатель - смещение в нем
+    (Command(Op::VertexAttribPointer) << index << size << type << normalized << stride)
+            .Size(reinterpret_cast<uintptr_t>(pointer));
+}
+
+void GLTrace::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    Count();
+    SetState(state.viewport, {{x, y, width, height}}, Op::Viewport);
+    glViewport(x, y, width, height);
+    CheckErrors("glViewport");
+    Command(Op::Viewport) << x << y << width << height;
+}
+
+void GLTrace::BindFramebuffer(GLenum target, GLuint framebuffer) {
+    Count();
+    SetState(state.framebuffer, framebuffer, Op::BindFramebuffer);
+    glBindFramebuffer(target, framebuffer);
+    CheckErrors("glBindFramebuffer");
+    Command(Op::BindFramebuffer) << target << framebuffer;
+}
+
+void GLTrace::BindTexture(GLenum target, GLuint texture) {
+    Count();
+    SetState(state.textures[target], texture, Op::BindTexture);
+    glBindTexture(target, texture);
+    CheckErrors("glBindTexture");
+    Command(Op::BindTexture) << target << texture;
+}
+
+GLenum GLTrace::CheckFramebufferStatus(GLenum target) {
+    Count();
+    GLenum status = glCheckFramebufferStatus(target);
+    CheckErrors("glCheckFramebufferStatus");
+    return status;
+}
+
+void GLTrace::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    Count();
+    if(Constant::glTrace) window.draws++;
+    glDrawArrays(mode, first, count);
+    CheckErrors("glDrawArrays");
+    Command(Op::DrawArrays) << mode << first << count;
+}
+
+void GLTrace::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    Count();
+    glFramebufferTexture2D(target, attachment, textarget, texture, level);
+    CheckErrors("glFramebufferTexture2D");
+    Command(Op::FramebufferTexture2D) << target << attachment << textarget << texture << level;
+}
+
+void GLTrace::GenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    Count();
+    glGenFramebuffers(n, framebuffers);
+    CheckErrors("glGenFramebuffers");
+    Command cmd(Op::GenFramebuffers);
+    cmd << n;
+    for(GLsizei i = 0; i < n; ++i) cmd << framebuffers[i];
+}
+
+void GLTrace::GenTextures(GLsizei n, GLuint* textures) {
+    Count();
+    glGenTextures(n, textures);
+    CheckErrors("glGenTextures");
+    Command cmd(Op::GenTextures);
+    cmd << n;
+    for(GLsizei i = 0; i < n; ++i) cmd << textures[i];
+}
+
+void GLTrace::TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                         GLint border, GLenum format, GLenum type, const void* pixels) {
+    Count();
+    glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    CheckErrors("glTexImage2D");
+    //Текстуры здесь - только цели отрисовки, пиксели не загружаются
+    Command(Op::TexImage2D) << target << level << internalformat << width << height << border << format << type;
+}
+
+void GLTrace::TexParameteri(GLenum target, GLenum pname, GLint param) {
+    Count();
+    glTexParameteri(target, pname, param);
+    CheckErrors("glTexParameteri");
+    Command(Op::TexParameteri) << target << pname << param;
+}
+
+void GLTrace::DisableVertexAttribArray(GLuint index) {
+    Count();
+    SetState(state.attribArrays[index], false, Op::DisableVertexAttribArray);
+    glDisableVertexAttribArray(index);
+    CheckErrors("glDisableVertexAttribArray");
+    Command(Op::DisableVertexAttribArray) << index;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <Utils.h>
+
+//Перехват вызовов OpenGL из Renderer.cpp. Включается на этапе компиляции:
+//Constant::glTrace - счетчики за кадр (вызовы, draw calls, загруженные байты, смены состояния
+//и избыточные смены, которые ничего не меняют) раз в Constant::glTraceFrames кадров в лог,
+//Constant::glCheckErrors - glGetError после каждого вызова,
+//Constant::glCapture - запись потока команд в файл для воспроизведения вне устройства.
+//Без флагов вызовы идут напрямую в OpenGL (см. макросы в конце файла)
+namespace GLTrace {
+    //Формат записи: заголовок {magic, version}, затем команды
+    //{uint32 op, uint32 длина аргументов, аргументы}. Аргументы - поля вызова в порядке
+    //параметров (GLenum, GLuint, GLint, GLfloat - 4 байта, размеры и смещения - 8 байт),
+    //данные буферов и строки шейдеров - длина uint32 и байты.
+    //Значения, которые вернул драйвер (имена буферов, программ, расположения переменных),
+    //записываются после аргументов, чтобы при воспроизведении сопоставить их со своими
+    static constexpr uint32_t captureMagic = 0x52544C47; //"GLTR"
+    static constexpr uint32_t captureVersion = 1;
+
+    enum class Op : uint32_t {
+        EndFrame = 0,
+        AttachShader, BindBuffer, BlendFunc, BufferData, BufferSubData, Clear, ClearColor,
+        CompileShader, CreateProgram, CreateShader, DeleteProgram, DepthMask, Disable,
+        DrawElements, Enable, EnableVertexAttribArray, GenBuffers, GetAttribLocation,
+        GetUniformLocation, LineWidth, LinkProgram, ShaderSource, Uniform1f, Uniform2f,
+        Uniform3f, UseProgram, VertexAttribPointer, Viewport,
+        BindFramebuffer, BindTexture, DrawArrays, FramebufferTexture2D, GenFramebuffers,
+        GenTextures, TexImage2D, TexParameteri,
+        DisableVertexAttribArray
+    };
+
+    //Файл для Constant::glCapture. Запись начинается с создания контекста
+    //и идет Constant::glCaptureFrames кадров
+    void SetCapturePath(const std::string& path);
+    //Новый контекст: прежнее состояние потеряно
+    void OnContextCreated();
+    //Конец кадра (Renderer::Draw)
+    void EndFrame();
+
+    void AttachShader(GLuint program, GLuint shader);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BlendFunc(GLenum sfactor, GLenum dfactor);
+    void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    void Clear(GLbitfield mask);
+    void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    void CompileShader(GLuint shader);
+    GLuint CreateProgram();
+    GLuint CreateShader(GLenum type);
+    void DeleteProgram(GLuint program);
+    void DepthMask(GLboolean flag);
+    void Disable(GLenum cap);
+    void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+    void Enable(GLenum cap);
+    void EnableVertexAttribArray(GLuint index);
+    void GenBuffers(GLsizei n, GLuint* buffers);
+    GLint GetAttribLocation(GLuint program, const GLchar* name);
+    void GetProgramiv(GLuint program, GLenum pname, GLint* params);
+    const GLubyte* GetString(GLenum name);
+    GLint GetUniformLocation(GLuint program, const GLchar* name);
+    void LineWidth(GLfloat width);
+    void LinkProgram(GLuint program);
+    void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+    void Uniform1f(GLint location, GLfloat v0);
+    void Uniform2f(GLint location, GLfloat v0, GLfloat v1);
+    void Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+    void UseProgram(GLuint program);
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                             GLsizei stride, const void* pointer);
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void BindFramebuffer(GLenum target, GLuint framebuffer);
+    void BindTexture(GLenum target, GLuint texture);
+    GLenum CheckFramebufferStatus(GLenum target);
+    void DrawArrays(GLenum mode, GLint first, GLsizei count);
+    void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    void GenFramebuffers(GLsizei n, GLuint* framebuffers);
+    void GenTextures(GLsizei n, GLuint* textures);
+    void TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                    GLint border, GLenum format, GLenum type, const void* pixels);
+    void TexParameteri(GLenum target, GLenum pname, GLint param);
+    void DisableVertexAttribArray(GLuint index);
+}
+
+//Подмена вызовов в файле, который подключает этот заголовок последним (Renderer.cpp).
+//Внутри макроса имя не раскрывается повторно, поэтому вторая ветка - настоящий вызов.
+//Условие - константа, лишняя ветка выбрасывается компилятором
+#ifndef GLTRACE_NO_REDIRECT
+#define GLTRACE_CALL(traced, real, ...) (Constant::glIntercept ? GLTrace::traced(__VA_ARGS__) : real(__VA_ARGS__))
+#define glAttachShader(...) GLTRACE_CALL(AttachShader, glAttachShader, __VA_ARGS__)
+#define glBindBuffer(...) GLTRACE_CALL(BindBuffer, glBindBuffer, __VA_ARGS__)
+#define glBlendFunc(...) GLTRACE_CALL(BlendFunc, glBlendFunc, __VA_ARGS__)
+#define glBufferData(...) GLTRACE_CALL(BufferData, glBufferData, __VA_ARGS__)
+#define glBufferSubData(...) GLTRACE_CALL(BufferSubData, glBufferSubData, __VA_ARGS__)
+#define glClear(...) GLTRACE_CALL(Clear, glClear, __VA_ARGS__)
+#define glClearColor(...) GLTRACE_CALL(ClearColor, glClearColor, __VA_ARGS__)
+#define glCompileShader(...) GLTRACE_CALL(CompileShader, glCompileShader, __VA_ARGS__)
+#define glCreateProgram() (Constant::glIntercept ? GLTrace::CreateProgram() : glCreateProgram())
+#define glCreateShader(...) GLTRACE_CALL(CreateShader, glCreateShader, __VA_ARGS__)
+#define glDeleteProgram(...) GLTRACE_CALL(DeleteProgram, glDeleteProgram, __VA_ARGS__)
+#define glDepthMask(...) GLTRACE_CALL(DepthMask, glDepthMask, __VA_ARGS__)
+#define glDisable(...) GLTRACE_CALL(Disable, glDisable, __VA_ARGS__)
+#define glDrawElements(...) GLTRACE_CALL(DrawElements, glDrawElements, __VA_ARGS__)
+#define glEnable(...) GLTRACE_CALL(Enable, glEnable, __VA_ARGS__)
+#define glEnableVertexAttribArray(...) GLTRACE_CALL(EnableVertexAttribArray, glEnableVertexAttribArray, __VA_ARGS__)
+#define glGenBuffers(...) GLTRACE_CALL(GenBuffers, glGenBuffers, __VA_ARGS__)
+#define glGetAttribLocation(...) GLTRACE_CALL(GetAttribLocation, glGetAttribLocation, __VA_ARGS__)
+#define glGetProgramiv(...) GLTRACE_CALL(GetProgramiv, glGetProgramiv, __VA_ARGS__)
+#define glGetString(...) GLTRACE_CALL(GetString, glGetString, __VA_ARGS__)
+#define glGetUniformLocation(...) GLTRACE_CALL(GetUniformLocation, glGetUniformLocation, __VA_ARGS__)
+#define glLineWidth(...) GLTRACE_CALL(LineWidth, glLineWidth, __VA_ARGS__)
+#define glLinkProgram(...) GLTRACE_CALL(LinkProgram, glLinkProgram, __VA_ARGS__)
+#define glShaderSource(...) GLTRACE_CALL(ShaderSource, glShaderSource, __VA_ARGS__)
+#define glUniform1f(...) GLTRACE_CALL(Uniform1f, glUniform1f, __VA_ARGS__)
+#define glUniform2f(...) GLTRACE_CALL(Uniform2f, glUniform2f, __VA_ARGS__)
+#define glUniform3f(...) GLTRACE_CALL(Uniform3f, glUniform3f, __VA_ARGS__)
+#define glUseProgram(...) GLTRACE_CALL(UseProgram, glUseProgram, __VA_ARGS__)
+#define glVertexAttribPointer(...) GLTRACE_CALL(VertexAttribPointer, glVertexAttribPointer, __VA_ARGS__)
+#define glViewport(...) GLTRACE_CALL(Viewport, glViewport, __VA_ARGS__)
+#define glBindFramebuffer(...) GLTRACE_CALL(BindFramebuffer, glBindFramebuffer, __VA_ARGS__)
+#define glBindTexture(...) GLTRACE_CALL(BindTexture, glBindTexture, __VA_ARGS__)
+#define glCheckFramebufferStatus(...) GLTRACE_CALL(CheckFramebufferStatus, glCheckFramebufferStatus, __VA_ARGS__)
+#define glDrawArrays(...) GLTRACE_CALL(DrawArrays, glDrawArrays, __VA_ARGS__)
+#define glFramebufferTexture2D(...) GLTRACE_CALL(FramebufferTexture2D, glFramebufferTexture2D, __VA_ARGS__)
+#define glGenFramebuffers(...) GLTRACE_CALL(GenFramebuffers, glGenFramebuffers, __VA_ARGS__)
+#define glGenTextures(...) GLTRACE_CALL(GenTextures, glGenTextures, __VA_ARGS__)
+#define glTexImage2D(...) GLTRACE_CALL(TexImage2D, glTexImage2D, __VA_ARGS__)
+#define glTexParameteri(...) GLTRACE_CALL(TexParameteri, glTexParameteri, __VA_ARGS__)
+#define glDisableVertexAttribArray(...) GLTRACE_CALL(DisableVertexAttribArray, glDisableVertexAttribArray, __VA_ARGS__)
+#endif
@@ -1,29 +1,35 @@
 #include <Game.h>
-#include <Controls.h>
+#include <AllocTracker.h>
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <sstream>
 #include <tuple>
 
-Game::Game() {
+Game::Game(unsigned seed, Platform* _platform)
+    : platform(_platform ? *_platform : defaultPlatform), random(seed),
+      controls(*this, renderer), score(renderer, platform) {
     isLevelRunning = true;
+    colX.reserve(Constant::collisionReserve);
+    colY.reserve(Constant::collisionReserve);
+    colRadius.reserve(Constant::collisionReserve);
+    colSpeed.reserve(Constant::collisionReserve);
+    colHit.reserve(Constant::collisionReserve);
+    sweepList.reserve(Constant::collisionReserve);
 
     ResetLogic();
     RequestRestart();
 
-    Renderer::InitInternals();
-    Controls::Init();
-    Score::Init();
-}
-
-Game& Game::Get() {
-    static Game instance;
-    return instance;
+    explosions.Init(renderer.GetGameObjectBatch(), random);
 }
 
 void Game::Restart() {
-    objects.clear();
-    Score::OnRestart();
+    ClearObjects();
+    explosions.Clear();
+    score.OnRestart();
     ResetLogic();
-    GameObject::Create<Ship>();
+    GameObject::Create<Ship>(*this);
     SpawnAsteroids(Constant::asteroidTargetCount);
 }
 
@@ -42,30 +48,93 @@ bool Game::IsLevelRunning(float dt) {
     return isLevelRunning;
 }
 
-void Game::Update() {
-    float deltaTime = timer.Tick();
+void Game::Update(long long vsyncNs) {
+    float dt = timer.Tick();
+    if(Constant::framePacing && vsyncNs != 0) dt = pacer.OnFrame(vsyncNs, FramePacer::Now(), GetFrameInterval());
+    const bool measured = !frameGap;
+    frameGap = false;
+    Step(dt);
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Render);
+    if(Constant::largeWorld) renderer.SetCamera(playerPos);
+    //Цель - период экрана, с ограничением частоты кадров - период ограничения
+    //Разрешение возвращается к полному только после остального качества
+    if(measured) renderer.OnFrameTime(dt, std::max(pacer.getPeriod(), GetFrameInterval()), governor.getLevel() == 0);
+    const auto renderStart = std::chrono::steady_clock::now();
+    renderer.Draw();
+    //Управляем качеством только из Update: Step без отрисовки (тесты, перемотка) остается детерминированным
+    if(Constant::qualityGovernor && measured) {
+        const float renderTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count();
+        if(governor.OnFrame({dt, simTime, collisionTime, renderTime}, pacer.getPeriod(), renderer.IsResolutionAtMin())) {
+            ApplyQuality();
+        }
+    }
+    redrawRequested = false;
+    //Следующий кадр будет только по вводу, через неизвестное время: отслеживание vsync
+    //остановится, и перерыв не должен считаться потерянными кадрами
+    if(IsFrameStatic()) {
+        pacer.Reset();
+        frameGap = true;
+    }
+    //Кадр закрывается после отрисовки, чтобы ее выделения попали в него, а не в следующий
+    AllocTracker::EndFrame();
+}
+
+void Game::ApplyQuality() {
+    explosions.setSpikeStep(governor.has(QualityStage::FewerSpikes) ? Constant::governorSpikeStep : 1);
+    renderer.SetOutlineDecimation(governor.has(QualityStage::DecimatedOutlines));
+    renderer.SetLineSmoothing(!governor.has(QualityStage::NoLineSmoothing));
+}
+
+void Game::Step(float deltaTime) {
+    if(Constant::frameHeapGuard) HeapGuard::Begin();
 
+    simTime = collisionTime = 0.0f;
     if(IsLevelRunning(deltaTime)) {
+        AllocTracker::ScopeGuard scope(AllocTracker::Scope::Sim);
+        const auto simStart = std::chrono::steady_clock::now();
         for(auto& go : objects) {
-            go->Update(deltaTime);
+            float dt = deltaTime;
+            if(Constant::largeWorld && !go->TakeLodStep(deltaTime, playerPos, dt)) continue;
+            go->Update(dt);
         }
 
-        DetectCollisions(deltaTime);
+        explosions.Update(deltaTime);
+
+        {
+            AllocTracker::ScopeGuard collisionScope(AllocTracker::Scope::Collision);
+            const auto collisionStart = std::chrono::steady_clock::now();
+            DetectCollisions(deltaTime);
+            if(Constant::qualityGovernor) {
+                collisionTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - collisionStart).count();
+                simTime = std::chrono::duration<float>(collisionStart - simStart).count();
+            }
+        }
 
         DestroyRequestedObjects(); //Удаление объектов предполагается только здесь
+        explosions.WriteModels(playerPos); //После столкновений, чтобы новые взрывы были видны в этом же кадре
+
+        if(recorder) recorder->Record(*this, deltaTime);
     }
 
-    Renderer::Draw();
+    frameArena.Reset();
+    if(Constant::frameHeapGuard) {
+        int allocations = HeapGuard::End();
+        //В отладочной сборке кадр с выделениями падает, в релизной - только предупреждение
+        if(allocations > 0) LOGW("Step touched the heap: %d allocations", allocations);
+        assert(allocations == 0 && "Step touched the heap");
+    }
 }
 
 void Game::OnGLInit() {
-    Renderer::InitGLContext();
+    renderer.InitGLContext();
+    redrawRequested = true;
 }
 
 void Game::OnResolutionChange(int w, int h) {
-    Renderer::OnResolutionChange(w, h);
-    Controls::Resize();
-    Score::Resize();
+    renderer.OnResolutionChange(w, h);
+    controls.Resize();
+    score.Resize();
+    redrawRequested = true;
 }
 
 GameObject& Game::AddGameObject(std::unique_ptr<GameObject> obj) {
@@ -74,6 +143,9 @@ GameObject& Game::AddGameObject(std::unique_ptr<GameObject> obj) {
 }
 
 void Game::DestroyRequestedObjects() {
+    sweepList.erase(std::remove_if(sweepList.begin(), sweepList.end(), [](const SweepEntry& e) {
+        return e.obj->isDestructionRequested();
+    }), sweepList.end());
     for(auto i = objects.begin(); i != objects.end();) {
         if((*i)->isDestructionRequested()) {
             i = objects.erase(i);
@@ -83,29 +155,183 @@ void Game::DestroyRequestedObjects() {
     }
 }
 
+void Game::ClearObjects() {
+    sweepList.clear();
+    sweepMaxId = 0;
+    objects.clear();
+}
+
+//Копируем положения и радиусы в плоские массивы, чтобы грубую проверку
+//для одной строки пар можно было выполнить одним векторизуемым циклом
+void Game::PackCollisionData() {
+    colX.clear();
+    colY.clear();
+    colRadius.clear();
+    colSpeed.clear();
+    for(auto& go : objects) {
+        Vec2 pos = go->getPosition();
+        colX.push_back(pos.x);
+        colY.push_back(pos.y);
+        colRadius.push_back(go->getRadius());
+        colSpeed.push_back(go->getVelocity().getLength());
+    }
+    colHit.resize(colX.size());
+}
+
 void Game::DetectCollisions(float dt) {
-    for(auto a = objects.begin(); a != objects.end(); ++a) {
-        for(auto b = std::next(a); b != objects.end(); ++b) { //Для каждой пары объектов
+    if(broadPhase == BroadPhase::SweepAndPrune) {
+        DetectCollisionsSweep(dt);
+        return;
+    }
+
+    //Объекты, созданные во время обработки (осколки), в массивы не попадают
+    //и проверяются как раньше, через DetectCollision
+    int packed = 0;
+    if(Constant::packedBroadPhase) {
+        PackCollisionData();
+        packed = colX.size();
+    }
+
+    int i = 0;
+    for(auto a = objects.begin(); a != objects.end(); ++a, ++i) {
+        if(i < packed) {
+            const float ax = colX[i], ay = colY[i], ar = colRadius[i], av = colSpeed[i];
+            const float* x = colX.data();
+            const float* y = colY.data();
+            const float* r = colRadius.data();
+            const float* v = colSpeed.data();
+            unsigned char* hit = colHit.data();
+            //То же выражение, что и в DetectCollision, в том же порядке операций
+            for(int j = i + 1; j < packed; ++j) {
+                float reach = ar + r[j];
+                if(Constant::continuousCollisions) reach = ar + r[j] + (av + v[j]) * dt;
+                hit[j] = Vec2(ax - x[j], ay - y[j]).getLength() < reach;
+            }
+        }
+        int j = i + 1;
+        for(auto b = std::next(a); b != objects.end(); ++b, ++j) { //Для каждой пары объектов
             GameObject& ra = **a;
             GameObject& rb = **b;
-            if(CollisionMask(ra, rb)) { //Требуется ли обработка столкновения
-                if(DetectCollision(ra, rb, dt)) { //Базовый алгоритм
-                    if(RefineCollision(ra, rb, dt)) { //Более точный
-                        ra.OnCollision(rb);
-                        rb.OnCollision(ra);
-                    }
-                }
+            CollisionHandler handler = GetCollisionHandler(ra, rb);
+            if(handler) { //Требуется ли обработка столкновения
+                bool near = (i < packed && j < packed) ? colHit[j] : DetectCollision(ra, rb, dt);
+                if(near) HandleCollision(ra, rb, handler, dt); //Базовый алгоритм
             }
         }
     }
 }
 
+//Корабль, пуля или маленький астероид
+static bool IsSmall(const GameObject& go) {
+    return go.getType() == GOType::Ship || go.getType() == GOType::Bullet ||
+           (go.getType() == GOType::Asteroid && go.as<Asteroid>().isSmall());
+}
+
+//Более точная проверка пары, прошедшей грубую, и обработка столкновения
+void Game::HandleCollision(GameObject& a, GameObject& b, CollisionHandler handler, float dt) {
+    //Пуля с пулей не сталкивается, так что пуля в паре не больше одной
+    bool hit;
+    if(governor.has(QualityStage::CoarseCollisions) && IsSmall(a) && IsSmall(b)) {
+        //Мелкие объекты почти круглые, грубой проверки по окружностям достаточно
+        if(a.getType() == GOType::Bullet) a.as<Bullet>().setHitPoint(a.getPosition());
+        else if(b.getType() == GOType::Bullet) b.as<Bullet>().setHitPoint(b.getPosition());
+        hit = true;
+    }
+    else if(a.getType() == GOType::Bullet) hit = RefineBulletCollision(a.as<Bullet>(), b, dt);
+    else if(b.getType() == GOType::Bullet) hit = RefineBulletCollision(b.as<Bullet>(), a, dt);
+    else hit = RefineCollision(a, b, dt);
+    if(hit) handler(a, b);
+}
+
+//Новые объекты дописываются в конец списка, затем сортировка вставками по левому краю.
+//Объект, перешедший шов ClampPos, проходит весь список за один шаг - это O(n),
+//но такое случается редко, остальные сдвигаются на одну-две позиции
+void Game::UpdateSweepList(float dt) {
+    //id растут в порядке objects, так что новые объекты - в хвосте списка
+    for(auto i = objects.rbegin(); i != objects.rend() && (*i)->getId() > sweepMaxId; ++i) {
+        sweepList.push_back(SweepEntry{i->get(), 0.f, 0.f, 0.f});
+    }
+    if(!objects.empty()) sweepMaxId = std::max(sweepMaxId, objects.back()->getId());
+
+    //Радиус с запасом на перемещение за шаг, только для отсечения по x
+    for(SweepEntry& e : sweepList) {
+        Vec2 pos = e.obj->getPosition();
+        e.reach = e.obj->getRadius();
+        if(Constant::continuousCollisions) e.reach += e.obj->getVelocity().getLength() * dt;
+        e.x = pos.x;
+        e.minX = pos.x - e.reach;
+    }
 
-bool Game::CollisionMask(const GameObject& a, const GameObject& b) {
-    //Если один из объектов логически уже уничтожен, то он не сталкивается с другими (return false)
-    return !(a.isDestructionRequested() || b.isDestructionRequested()) &&
-    //Если ни одному из объектов не требуется обработка столкновения с другим, то возвращаем false
-    (a.CollisionMask(b.getStaticType()) || b.CollisionMask(a.getStaticType()));
+    for(size_t k = 1; k < sweepList.size(); ++k) {
+        SweepEntry e = sweepList[k];
+        size_t j = k;
+        for(; j > 0 && sweepList[j - 1].minX > e.minX; --j) {
+            sweepList[j] = sweepList[j - 1];
+        }
+        sweepList[j] = e;
+    }
+}
+
+//Пары с пересекающимися по x интервалами проходят ту же проверку окружностей,
+//что и в переборе всех пар, и обрабатываются в том же порядке (по порядку objects),
+//поэтому результат не зависит от выбранной широкой фазы
+void Game::DetectCollisionsSweep(float dt) {
+    UpdateSweepList(dt);
+    if(sweepList.empty()) return;
+
+    struct Pair {
+        GameObject* a;
+        GameObject* b;
+    };
+    FrameAllocator<Pair> alloc(frameArena);
+    FrameVector<Pair> pairs(alloc);
+    const size_t n = sweepList.size();
+    for(size_t k = 0; k < n; ++k) {
+        const SweepEntry& ek = sweepList[k];
+        //Небольшой запас, чтобы округление не отбросило пару, которую примет проверка окружностей
+        const float maxX = ek.x + ek.reach + Constant::smallNumber;
+        for(size_t l = k + 1; l < n && sweepList[l].minX <= maxX; ++l) {
+            const SweepEntry& el = sweepList[l];
+            //Астероиды перекрываются друг с другом постоянно, отсекаем такие пары до проверки окружностей
+            if(!collisionMask[static_cast<int>(ek.obj->getType())][static_cast<int>(el.obj->getType())]) continue;
+            //a - раньше в objects (меньший id), как в переборе всех пар
+            const SweepEntry& a = ek.obj->getId() < el.obj->getId() ? ek : el;
+            const SweepEntry& b = ek.obj->getId() < el.obj->getId() ? el : ek;
+            //Та же проверка окружностей, что и в переборе всех пар, без перестановки слагаемых
+            if(DetectCollision(*a.obj, *b.obj, dt)) pairs.push_back(Pair{a.obj, b.obj});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& l, const Pair& r) {
+        return l.a->getId() != r.a->getId() ? l.a->getId() < r.a->getId() : l.b->getId() < r.b->getId();
+    });
+
+    //Объекты, созданные во время обработки (осколки), в sweepList еще нет,
+    //они дописываются после lastSwept и проверяются как в переборе всех пар
+    const auto lastSwept = std::prev(objects.end());
+    bool swept = true;
+    auto next = pairs.begin();
+    for(auto a = objects.begin(); a != objects.end(); ++a) {
+        GameObject& ra = **a;
+        for(; swept && next != pairs.end() && next->a == &ra; ++next) {
+            CollisionHandler handler = GetCollisionHandler(ra, *next->b);
+            if(handler) HandleCollision(ra, *next->b, handler, dt);
+        }
+        auto b = swept ? std::next(lastSwept) : std::next(a);
+        if(a == lastSwept) swept = false;
+        for(; b != objects.end(); ++b) {
+            GameObject& rb = **b;
+            CollisionHandler handler = GetCollisionHandler(ra, rb);
+            if(handler && DetectCollision(ra, rb, dt)) HandleCollision(ra, rb, handler, dt);
+        }
+    }
+}
+
+
+CollisionHandler Game::GetCollisionHandler(const GameObject& a, const GameObject& b) {
+    //Если один из объектов логически уже уничтожен, то он не сталкивается с другими
+    if(a.isDestructionRequested() || b.isDestructionRequested()) return nullptr;
+    //Для пар типов, которым не требуется обработка столкновения, в таблице nullptr
+    return collisionTable[static_cast<int>(a.getType())][static_cast<int>(b.getType())];
 }
 
 //Обнаружение столкновений по радиусу окружности, описывающей модель объекта
@@ -150,6 +376,40 @@ bool Game::RefineCollision(const GameObject& a, const GameObject& b, float dt) {
     }
 }
 
+//Модель пули - один отрезок. Вместо перебора пар отрезков в RefineCollision пуля
+//считается лучом: от задней точки в начале шага до передней в конце, в системе отсчета цели.
+//Ищем первое пересечение луча с контуром цели и запоминаем точку удара в пуле
+bool Game::RefineBulletCollision(Bullet& bullet, const GameObject& target, float dt) {
+    bullet.setHitPoint(bullet.getPosition());
+    if(!Constant::refineCollisions) return true;
+    if(!Constant::bulletRayCollisions) return RefineCollision(bullet, target, dt);
+
+    const std::vector<GLfloat>& bv = bullet.getModel().getTransformed();
+    Vec2 back(bv[0], bv[1]), front(bv[2], bv[3]);
+    Vec2 sweep = Constant::continuousCollisions ? (bullet.getVelocity() - target.getVelocity()) * dt : Vec2();
+    if(Vec2::DotProduct(front - back, sweep) < 0) std::swap(back, front);
+    const Vec2 p = back - sweep;
+    const Vec2 r = front - p;
+
+    const Model& tm = target.getModel();
+    const std::vector<GLfloat>& tv = tm.getTransformed();
+    const std::vector<GLubyte>& ti = tm.getIndices();
+    float first = 2.f; //Параметр ближайшего пересечения вдоль луча, больше 1 - нет пересечения
+    for(int j = 0; j < ti.size(); j += 2) {
+        Vec2 q(j, tv, ti);
+        Vec2 s = Vec2(j + 1, tv, ti) - q;
+        float det = Vec2::CrossProd2D(r, s);
+        if(fabs(det) <= Constant::smallNumber) continue;
+        Vec2 diff = q - p;
+        float f = Vec2::CrossProd2D(diff, s) / det;
+        float g = Vec2::CrossProd2D(diff, r) / det;
+        if(f >= 0 && f < first && g >= 0 && g <= 1) first = f;
+    }
+    if(first > 1) return false;
+    bullet.setHitPoint(p + r * first);
+    return true;
+}
+
 bool Game::SegmentCollision(Vec2 p, Vec2 r, Vec2 q, Vec2 s) {
     //http://stackoverflow.com/a/565282/2502024
     float det = Vec2::CrossProd2D(r, s);
@@ -212,17 +472,177 @@ bool Game::MovingSegmentCollision(Vec2 p, Vec2 r, Vec2 vp, Vec2 q, Vec2 s, Vec2
 void Game::RequestRestart(float t) {
     wantRestart = true;
     restartTimer = t;
+    redrawRequested = true;
+}
+
+void Game::Reset(unsigned seed) {
+    random.generator.seed(seed);
+    wantRestart = false;
+    Restart();
+    isLevelRunning = true;
+    controls.onResume();
+}
+
+void Game::SaveSnapshot(std::vector<unsigned char>& out) const {
+    out.clear();
+    SnapshotWriter w(out);
+    w.Put(Snapshot::Header());
+    size_t payloadStart = w.size();
+
+    w.Put<uint32_t>(objects.size());
+    for(auto& go : objects) {
+        GOType type = go->getStaticType();
+        w.Put<uint8_t>(static_cast<uint8_t>(type));
+        //Форма есть только у астероидов, остальные модели создаются по типу
+        if(type == GOType::Asteroid) w.PutArray(go->getModel().getVerts());
+        go->Save(w);
+    }
+    explosions.Save(w);
+
+    w.Put<int32_t>(currentId);
+    w.Put<int32_t>(asteroidCount);
+    w.Put<uint8_t>(isUfoPresent);
+    w.Put(playerPos);
+    w.Put<uint8_t>(isLevelRunning);
+    w.Put<uint8_t>(wantRestart);
+    w.Put(restartTimer);
+
+    std::ostringstream rs;
+    rs << random.generator;
+    w.PutString(rs.str());
+
+    w.Put<int32_t>(score.getScore());
+    w.Put<int32_t>(score.getHighScore());
+
+    Snapshot::Header h;
+    h.magic = Snapshot::magic;
+    h.version = Snapshot::version;
+    h.payloadSize = w.size() - payloadStart;
+    h.checksum = Snapshot::Checksum(w.at(payloadStart), h.payloadSize);
+    memcpy(w.at(0), &h, sizeof(h));
+}
+
+bool Game::LoadSnapshot(const unsigned char* data, size_t size) {
+    Snapshot::Header h;
+    if(size < sizeof(h)) return false;
+    memcpy(&h, data, sizeof(h));
+    if(h.magic != Snapshot::magic || h.version != Snapshot::version ||
+       h.payloadSize != size - sizeof(h) ||
+       h.checksum != Snapshot::Checksum(data + sizeof(h), h.payloadSize)) {
+        return false;
+    }
+
+    SnapshotReader r(data + sizeof(h), h.payloadSize);
+    ClearObjects();
+
+    //Конструкторы объектов могут трогать логику и генератор,
+    //поэтому они восстанавливаются после объектов
+    uint32_t n = 0;
+    r.Get(n);
+    for(uint32_t i = 0; i < n && r.isOk(); ++i) {
+        uint8_t type = 0;
+        r.Get(type);
+        switch(static_cast<GOType>(type)) {
+        case GOType::Ship:
+            GameObject::Create<Ship>(*this).Load(r);
+            break;
+        case GOType::Asteroid: {
+            std::vector<GLfloat> verts;
+            if(r.GetArray(verts) && verts.size() >= 6 && verts.size() % 2 == 0) {
+                GameObject::Create<Asteroid>(*this, Transform(), std::make_shared<Model>(verts)).Load(r);
+            } else {
+                r.Fail();
+            }
+            break;
+        }
+        case GOType::UFO:
+            GameObject::Create<UFO>(*this).Load(r);
+            break;
+        case GOType::Bullet:
+            GameObject::Create<Bullet>(*this).Load(r);
+            break;
+        default:
+            r.Fail();
+        }
+    }
+    explosions.Load(r);
+
+    int32_t id = 0, asteroids = 0, points = 0, highPoints = 0;
+    uint8_t ufo = 0, running = 0, restart = 0;
+    std::string generatorState;
+    r.Get(id);
+    r.Get(asteroids);
+    r.Get(ufo);
+    r.Get(playerPos);
+    r.Get(running);
+    r.Get(restart);
+    r.Get(restartTimer);
+    r.GetString(generatorState);
+    r.Get(points);
+    r.Get(highPoints);
+
+    std::istringstream rs(generatorState);
+    rs >> random.generator;
+    if(!r.isOk() || !r.atEnd() || rs.fail() || points < 0 || highPoints < 0) {
+        ClearObjects();
+        explosions.Clear();
+        ResetLogic();
+        RequestRestart();
+        return false;
+    }
+
+    currentId = id;
+    asteroidCount = asteroids;
+    isUfoPresent = ufo != 0;
+    isLevelRunning = running != 0;
+    wantRestart = restart != 0;
+    score.Restore(static_cast<unsigned>(points), static_cast<unsigned>(highPoints));
+    explosions.WriteModels(playerPos);
+    if(isLevelRunning) {
+        controls.onResume();
+    } else {
+        controls.onPause();
+    }
+    timer.Tick();
+    pacer.Reset();
+    frameGap = true;
+    redrawRequested = true;
+    return true;
+}
+
+bool Game::StartRecording(const std::string& path, int keyframeInterval) {
+    recorder.reset(new Recorder());
+    if(!recorder->Open(path, keyframeInterval)) {
+        recorder.reset();
+        return false;
+    }
+    return true;
+}
+
+void Game::FlushRecording() {
+    if(recorder) recorder->Flush();
+}
+
+void Game::StopRecording() {
+    recorder.reset();
 }
 
 void Game::Pause() {
     isLevelRunning = false;
-    Controls::onPause();
+    controls.onPause();
+    redrawRequested = true;
+    pacer.Reset();
+    frameGap = true;
 }
 
+//Таймер не тикал всю паузу (без перерисовок в том числе), первый шаг после нее - с нуля
 void Game::Resume() {
     isLevelRunning = true;
-    Controls::onResume();
+    controls.onResume();
     timer.Tick();
+    pacer.Reset();
+    frameGap = true;
+    redrawRequested = true;
 }
 
 void Game::SetPlayerPos(const Ship& player) {
@@ -234,13 +654,13 @@ Vec2 Game::GetPlayerPos() {
 }
 
 void Game::AddPoints(int pointsToAdd) {
-    Score::AddPoints(pointsToAdd);
+    score.AddPoints(pointsToAdd);
 }
 
 void Game::DecAsteroidCount(const Asteroid& a) {
     asteroidCount--;
     if(asteroidCount == Constant::asteroidUfoCount * 2 && !isUfoPresent) {
-        GameObject::Create<UFO>(GetUfoSpawn());
+        GameObject::Create<UFO>(*this, GetUfoSpawn());
     }
     if(asteroidCount <= Constant::asteroidRespawnCount * 2) {
         SpawnAsteroids(Constant::asteroidTargetCount - Constant::asteroidRespawnCount);
@@ -259,25 +679,36 @@ void Game::ResetLogic() {
 
 void Game::SpawnAsteroids(int n) {
     for(int i = 0; i < n; ++i) {
-        GameObject::Create<Asteroid>(GetSpawnPosition());
+        GameObject::Create<Asteroid>(*this, GetSpawnPosition());
     }
 }
 
 //Создаем астероид так, чтобы сразу не убить игрока (с учетом зацикленности игровых координат)
 Transform Game::GetSpawnPosition() {
+    if(Constant::largeWorld) {
+        //По всему миру, но не рядом с игроком
+        std::uniform_real_distribution<float> w(-Constant::worldXExtent, Constant::worldXExtent);
+        std::uniform_real_distribution<float> h(-Constant::worldYExtent, Constant::worldYExtent);
+        Vec2 pos, d;
+        do {
+            pos = Vec2(w(random.generator), h(random.generator));
+            d = Transform::WrapDelta(pos - playerPos);
+        } while(fabs(d.x) < Constant::worldRatio + 0.2f && fabs(d.y) < 1.2f);
+        return Transform(pos);
+    }
     std::uniform_real_distribution<float> zone(-Constant::asteroidSpawnZone, Constant::asteroidSpawnZone);
     Vec2 pos(Constant::worldRatio + 0.2, 1.2);
     if(fabs(playerPos.x) > Constant::asteroidSpawnZone &&
          fabs(playerPos.y) < Constant::asteroidSpawnZone) {
-        pos.y = zone(Random::generator);
+        pos.y = zone(random.generator);
     } else if(fabs(playerPos.x) < Constant::asteroidSpawnZone &&
                 fabs(playerPos.y) > Constant::asteroidSpawnZone) {
-        pos.x = zone(Random::generator);
+        pos.x = zone(random.generator);
     } else {
-        if(Random::flipCoin()) {
-            pos.x = zone(Random::generator);
+        if(random.flipCoin()) {
+            pos.x = zone(random.generator);
         } else {
-            pos.y = zone(Random::generator);
+            pos.y = zone(random.generator);
         }
     }
     return Transform(pos);
@@ -285,7 +716,12 @@ Transform Game::GetSpawnPosition() {
 
 Transform Game::GetUfoSpawn() {
     std::uniform_real_distribution<float> zone(-Constant::ufoZone, Constant::ufoZone);
-    return Transform((Constant::worldRatio + 0.12) * (playerPos.x > 0 ? -1 : 1), zone(Random::generator));
+    if(Constant::largeWorld) {
+        //Сразу за краем экрана игрока
+        float side = random.flipCoin() ? -1.f : 1.f;
+        return Transform(playerPos + Vec2((Constant::worldRatio + 0.12f) * side, zone(random.generator)));
+    }
+    return Transform((Constant::worldRatio + 0.12) * (playerPos.x > 0 ? -1 : 1), zone(random.generator));
 }
 
 void Game::OnUfoCreated(const UFO& u) {
@@ -294,4 +730,8 @@ void Game::OnUfoCreated(const UFO& u) {
 
 void Game::OnUfoDestroyed(const UFO& u) {
     isUfoPresent = false;
-}
\ No newline at end of file
+}
+
+void Game::SpawnExplosion(const Vec2& pos) {
+    explosions.Spawn(pos);
+}
@@ -4,20 +4,54 @@
 #include <list>
 
 #include <GameObject.h>
+#include <Explosions.h>
+#include <Controls.h>
 #include <Score.h>
+#include <Platform.h>
+#include <Recording.h>
+#include <FrameArena.h>
+#include <QualityGovernor.h>
+#include <FramePacer.h>
 
+//Способ отбора пар объектов для проверки столкновений
+enum class BroadPhase {
+    AllPairs,       //все пары, с Constant::packedBroadPhase - по плоским массивам
+    SweepAndPrune   //отсортированные по x интервалы, порядок сохраняется между шагами
+};
+
+//Одна игра со своим миром, рендерером, управлением и счётом
+//Разные экземпляры ничего не разделяют и могут обновляться из разных потоков
 class Game {
-    //Синглтон, приватные конструкторы
-    Game();
-    Game(const Game&);
-    Game& operator=(const Game&);
+    friend class Benchmark;
+    Platform defaultPlatform;
+    Platform& platform;
+    Random random;
+    int currentId = 0;
+
+    Renderer renderer;
+    Controls controls;
+    Score score;
 
     //Все игровые объекты обитают здесь
+    //Объявлены после renderer, чтобы удаляться раньше него
     std::list<std::unique_ptr<GameObject>> objects;
     //Game распоряжается временем жизни объектов
     void DestroyRequestedObjects();
+    void ClearObjects();
+
+    //Взрывы - не игровые объекты, живут в своей системе частиц
+    Explosions explosions;
 
     Timer timer;
+    FramePacer pacer;
+    //Время фаз последнего шага, заполняется при Constant::qualityGovernor
+    float simTime = 0.0f, collisionTime = 0.0f;
+    QualityGovernor governor;
+    void ApplyQuality();
+    //Временные данные шага, очищается в конце Step
+    mutable FrameArena frameArena;
+    //Запись партии, пишется после каждого шага
+    std::unique_ptr<Recorder> recorder;
 
     //Игровая логика
     Vec2 playerPos;
@@ -32,20 +66,93 @@ class Game {
     bool isLevelRunning;
     bool wantRestart;
     float restartTimer;
+    //Кадр изменился с последней отрисовки помимо симуляции (ввод, пауза, новый контекст)
+    bool redrawRequested = true;
+    //Между прошлым кадром и следующим был перерыв (пауза, неподвижный кадр, загрузка снимка):
+    //dt следующего кадра - не время кадра, разрешение и качество по нему не меняются
+    bool frameGap = true;
     void Restart();
     bool IsLevelRunning(float dt);
 
     //Обнаружение коллизий
+    //Положения, радиусы и скорости объектов на начало проверки, хранятся между кадрами
+    std::vector<float> colX, colY, colRadius, colSpeed;
+    std::vector<unsigned char> colHit;
+    void PackCollisionData();
     void DetectCollisions(float dt);
-    bool CollisionMask(const GameObject& a, const GameObject& b);
+
+    //Sweep and prune: интервалы объектов по x, отсортированные на прошлом шаге.
+    //Объекты движутся медленно, поэтому сортировка вставками почти ничего не переставляет
+    struct SweepEntry {
+        GameObject* obj;
+        float minX, x, reach;
+    };
+    BroadPhase broadPhase = Constant::sweepAndPrune ? BroadPhase::SweepAndPrune : BroadPhase::AllPairs;
+    std::vector<SweepEntry> sweepList;
+    int sweepMaxId = 0; //объекты с большим id еще не добавлены в sweepList
+    void UpdateSweepList(float dt);
+    void DetectCollisionsSweep(float dt);
+
+    void HandleCollision(GameObject& a, GameObject& b, CollisionHandler handler, float dt);
+    CollisionHandler GetCollisionHandler(const GameObject& a, const GameObject& b);
     bool DetectCollision(const GameObject& a, const GameObject& b, float dt);
     bool RefineCollision(const GameObject& a, const GameObject& b, float dt);
+    bool RefineBulletCollision(Bullet& bullet, const GameObject& target, float dt);
     bool SegmentCollision(Vec2 p, Vec2 r, Vec2 q, Vec2 s);
     bool MovingSegmentCollision(Vec2 p, Vec2 r, Vec2 vp, Vec2 q, Vec2 s, Vec2 vq, float dt);
 
 public:
-    static Game& Get();
-    void Update();
+    //platform == nullptr - игра без связи с платформой (рекорд не сохраняется)
+    explicit Game(unsigned seed, Platform* _platform = nullptr);
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
+
+    //Шаг по реальному времени с отрисовкой
+    //vsyncNs - время последнего vsync (System.nanoTime()), 0 - шаг по таймеру
+    void Update(long long vsyncNs = 0);
+    void SetRefreshRate(float hz) { pacer.SetRefreshRate(hz); };
+    //Картинка не изменится, пока не придет ввод: игра на паузе и после последней
+    //отрисовки ничего не произошло (взрывы на паузе тоже стоят)
+    //Тогда платформа может не перерисовывать экран (см. Constant::idleThrottling)
+    bool IsFrameStatic() const { return Constant::idleThrottling && !isLevelRunning && !redrawRequested; };
+    void RequestRedraw() { redrawRequested = true; };
+    //Минимальный период кадра в секундах, 0 - без ограничения (см. QualityStage::HalfFrameRate)
+    float GetFrameInterval() const {
+        return governor.has(QualityStage::HalfFrameRate) ? Constant::governorCappedFrameTime : 0.0f;
+    };
+    //Только симуляция на dt секунд, без отрисовки и таймера
+    void Step(float dt);
+
+    //Немедленный перезапуск уровня с новым зерном, снимает паузу
+    void Reset(unsigned seed);
+
+    //Снимок всего мира: объекты, взрывы, логика, генератор случайных чисел и счёт
+    //Можно сохранять на диск (см. Wrapper.cpp) или держать в памяти для перемотки
+    void SaveSnapshot(std::vector<unsigned char>& out) const;
+    //При ошибке в данных уровень перезапускается, возвращается false
+    bool LoadSnapshot(const unsigned char* data, size_t size);
+
+    //Запись партии в файл (см. Recording.h), кадр кодируется после каждого шага на уровне,
+    //на диск его пишет поток записи
+    bool StartRecording(const std::string& path, int keyframeInterval = Constant::recordKeyframeInterval);
+    //Дописывает накопленные кадры и индекс, чтобы запись можно было читать, даже если процесс будет убит
+    void FlushRecording();
+    void StopRecording();
+
+    Random& GetRandom() { return random; };
+    Controls& GetControls() { return controls; };
+    Renderer& GetRenderer() { return renderer; };
+    Platform& GetPlatform() { return platform; };
+    const FramePacer& GetFramePacer() const { return pacer; };
+    FrameArena& GetFrameArena() const { return frameArena; };
+    Score& GetScore() { return score; };
+    const Score& GetScore() const { return score; };
+    const std::list<std::unique_ptr<GameObject>>& GetObjects() const { return objects; };
+    bool IsRunning() const { return isLevelRunning; };
+    //Переключение широкой фазы на лету, на результат не влияет
+    void SetBroadPhase(BroadPhase phase) { broadPhase = phase; };
+    BroadPhase GetBroadPhase() const { return broadPhase; };
+    int NextObjectId() { return ++currentId; };
 
     //Обновление рендеринга
     void OnGLInit();
@@ -68,5 +175,6 @@ public:
     void DecAsteroidCount(const Asteroid& a);
     void OnUfoCreated(const UFO& u);
     void OnUfoDestroyed(const UFO& u);
+    void SpawnExplosion(const Vec2& pos);
 
 };
\ No newline at end of file
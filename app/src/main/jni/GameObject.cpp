@@ -1,31 +1,31 @@
 #include <GameObject.h>
-#include <Controls.h>
-#include <Wrapper.h>
 #include <Game.h>
 
 //Для упрощения создания базового класса. Если в Create передана модель,
 //то используем её, если нет, то создаём модель по умолчанию согласно типу
-#define InitBase(type) GameObject(pos, mod ? mod : Model::Create##type())
-
-int GameObject::currentId = 0;
-
-GameObject& GameObject::PushToGame(std::unique_ptr<GameObject>&& obj) {
-    return Game::Get().AddGameObject(std::move(obj));
+#define InitBase(type) GameObject(_game, pos, mod ? mod : Model::Create##type())
+
+GameObject& GameObject::PushToGame(Game& game, std::unique_ptr<GameObject>&& obj) {
+    obj->setId(game.NextObjectId());
+    obj->mType = obj->getStaticType();
+    //Разносим обновления дальних объектов по разным шагам
+    obj->lodSkipped = obj->mId % Constant::simLodInterval;
+    return game.AddGameObject(std::move(obj));
 }
 
 void GameObject::RequestDestruction() {
     aboutToDestroy = true;
 }
 
-GameObject::GameObject(const Transform& pos, std::shared_ptr<Model> mod) : t(pos), model(mod) {
+GameObject::GameObject(Game& _game, const Transform& pos, std::shared_ptr<Model> mod) : game(_game), t(pos), model(mod) {
     //Если всё же кто-то передал mod == nullptr, то упадём здесь (а не внезапно где-нибудь позже)
     t.setMargin(model->getRadius());
-    Renderer::GetGameObjectBatch().Add(model);//Добавляем модель на отрисовку
+    game.GetRenderer().GetGameObjectBatch().Add(model);//Добавляем модель на отрисовку
     model->ApplyTransform(t);
 }
 
 GameObject::~GameObject() {
-   Renderer::GetGameObjectBatch().Remove(model);
+   game.GetRenderer().GetGameObjectBatch().Remove(model);
 }
 
 void GameObject::Move(float deltaTime) {
@@ -37,38 +37,76 @@ void GameObject::Rotate(float deltaAngle) {
     t.setAngle(t.getAngle() + deltaAngle);
 }
 
+bool GameObject::TakeLodStep(float dt, const Vec2& playerPos, float& stepDt) {
+    lodTime += dt;
+    Vec2 d = Transform::WrapDelta(t.getPos() - playerPos);
+    bool far = d.x * d.x + d.y * d.y > Constant::simLodDistance * Constant::simLodDistance;
+    if(far && ++lodSkipped < Constant::simLodInterval) return false;
+    lodSkipped = 0;
+    stepDt = lodTime;
+    lodTime = 0.f;
+    return true;
+}
+
+void GameObject::Save(SnapshotWriter& w) const {
+    w.Put<int32_t>(mId);
+    w.Put(t.getPos());
+    w.Put(t.getAngle());
+    w.Put(vel);
+    w.Put(lodTime);
+    w.Put<int32_t>(lodSkipped);
+}
+
+void GameObject::Load(SnapshotReader& r) {
+    int32_t id = 0;
+    Vec2 pos;
+    float angle = 0.f;
+    r.Get(id);
+    r.Get(pos);
+    int32_t skipped = 0;
+    r.Get(angle);
+    r.Get(vel);
+    r.Get(lodTime);
+    r.Get(skipped);
+    lodSkipped = skipped;
+    setId(id);
+    t.setPos(pos);
+    t.setAngle(angle);
+    model->ApplyTransform(t);
+}
+
 
 ///Ship///
 
-Ship::Ship(const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Ship) {
+Ship::Ship(Game& _game, const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Ship) {
     //Дополнительная модель
     engine = Model::CreateShipEngine();
-    Renderer::GetGameObjectBatch().Add(engine);
+    game.GetRenderer().GetGameObjectBatch().Add(engine);
 };
 
 Ship::~Ship() {
-    Renderer::GetGameObjectBatch().Remove(engine);
+    game.GetRenderer().GetGameObjectBatch().Remove(engine);
 };
 
 void Ship::Update(float dt) {
-    float fwd = Controls::Forward();
+    float fwd = game.GetControls().Forward();
     engine->setDraw(fwd > 0.f); //Отрисовываем только когда двигатель включен (жмем вперед)
 
-    Rotate(rotSpeed * dt * Controls::HorAxis());
+    Rotate(rotSpeed * dt * game.GetControls().HorAxis());
     //Ускоряемся в направлении корабля, замедляемся в направлении скорости
     acc = (t.getDirection() * fwd * throttle) - (vel * friction);
     vel = vel + acc * dt;
     Move(dt);
     engine->ApplyTransform(t);
-    Game::Get().SetPlayerPos(*this); //Оповещаем игровую логику об изменении позиции
+    game.SetPlayerPos(*this); //Оповещаем игровую логику об изменении позиции
 
     //Стреляем с кулдауном
     if(cooldownTimer <= 0.f) {
-        if(Controls::Shooting()) {
+        if(game.GetControls().Shooting()) {
             cooldownTimer = cooldown;
             //Создаём пулю в районе носа корабля, угол поворота пули совпадает с углом поворота корабля
             Vec2 spawn = t.getPos() + t.getDirection() * model->getRadius() * 0.5f;
-            Bullet& b = GameObject::Create<Bullet>(spawn.x, spawn.y, t.getAngle()).as<Bullet>();
+            Bullet& b = GameObject::Create<Bullet>(game, spawn.x, spawn.y, t.getAngle()).as<Bullet>();
             //Пуля летит в направлении корабля в момент выстрела. К ее скорости добавляется часть скорости корабля
             b.setVelocity(t.getDirection() * (Constant::bulletSpeedBasic + vel.getLength() * Constant::bulletSpeedInherited));
             b.shotByPlayer(true);
@@ -79,11 +117,11 @@ void Ship::Update(float dt) {
 
     //Телепортируемся в случайную точку на экране
     if(teleportTimer <= 0.f) {
-        if(Controls::Teleport()) {
-            std::uniform_real_distribution<float> w(-Constant::worldRatio, Constant::worldRatio);
-            std::uniform_real_distribution<float> h(-1.f, 1.f);
+        if(game.GetControls().Teleport()) {
+            std::uniform_real_distribution<float> w(-Constant::worldXExtent, Constant::worldXExtent);
+            std::uniform_real_distribution<float> h(-Constant::worldYExtent, Constant::worldYExtent);
             teleportTimer = teleportcd;
-            t.setPos(Vec2(w(Random::generator), h(Random::generator)));
+            t.setPos(Vec2(w(game.GetRandom().generator), h(game.GetRandom().generator)));
             setVelocity(Vec2());
         }
     } else {
@@ -93,73 +131,73 @@ void Ship::Update(float dt) {
     //Начисляем очки за каждые прожитые pointsTimeInterval секунд
     if(pointsTimer <= 0.f) {
         pointsTimer = Constant::pointsTimeInterval;
-        Game::Get().AddPoints(Constant::pointsForTime);
+        game.AddPoints(Constant::pointsForTime);
     } else {
         pointsTimer -= dt;
     }
 }
 
-bool Ship::CollisionMask(GOType type) const {
-    switch(type) {
-    case GOType::Asteroid:
-    case GOType::Bullet:
-    case GOType::UFO:
-        return true;
-    default:
-        return false;
-    };
+void Ship::Save(SnapshotWriter& w) const {
+    GameObject::Save(w);
+    w.Put(acc);
+    w.Put(cooldownTimer);
+    w.Put(teleportTimer);
+    w.Put(pointsTimer);
 }
 
-void Ship::OnCollision(const GameObject& obj) {
-    if(obj.getStaticType() == GOType::Bullet) {
-        //Не умираем от своей пули
-        if(obj.as<Bullet>().isShotByPlayer()) return;
-    }
-    GameObject::Create<Explosion>(t); //Взрыв на месте уничтожения
+void Ship::Load(SnapshotReader& r) {
+    GameObject::Load(r);
+    r.Get(acc);
+    r.Get(cooldownTimer);
+    r.Get(teleportTimer);
+    r.Get(pointsTimer);
+    engine->ApplyTransform(t);
+}
+
+void Ship::OnHit(const Bullet& bullet) {
+    //Не умираем от своей пули
+    if(bullet.isShotByPlayer()) return;
+    Explode();
+}
+
+void Ship::Explode() {
+    game.SpawnExplosion(t.getPos()); //Взрыв на месте уничтожения
     RequestDestruction();
-    if(Constant::vibrateOnDeath) JavaCall::Vibrate();
+    if(Constant::vibrateOnDeath) game.GetPlatform().Vibrate();
     //Запрашиваем перезапуск игры через некоторое время после уничтожения
-    Game::Get().RequestRestart(Constant::restartAfterDeathSec);
+    game.RequestRestart(Constant::restartAfterDeathSec);
 }
 
 
 ///Asteroid///
 
-Asteroid::Asteroid(const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Asteroid) {
+Asteroid::Asteroid(Game& _game, const Transform& pos, std::shared_ptr<Model> mod)
+    : GameObject(_game, pos, mod ? mod : Model::CreateAsteroid(_game.GetRandom())) {
+    model->setOutline(true);
     //Если астероид большой, то летим в случайном направлении с постоянной скоростью
     if(!isSmall())  {
         std::uniform_real_distribution<float> direction(0, 2*M_PI);
-        float angle = direction(Random::generator);
-        setVelocity(Vec2(cos(angle), sin(angle)) * Constant::asteroidSpeed);
-        Game::Get().IncAsteroidCount(*this);
+        float s, c;
+        FastMath::SinCos(direction(game.GetRandom().generator), s, c);
+        setVelocity(Vec2(c, s) * Constant::asteroidSpeed);
+        game.IncAsteroidCount(*this);
     }
     //Если маленький, то скорость сообщат снаружи через SetVelocity
 }
 
-bool Asteroid::CollisionMask(GOType type) const {
-    switch(type) {
-    case GOType::Ship:
-    case GOType::Bullet:
-        return true;
-    default:
-        return false;
-    };
-}
-
 //Размер астероида определяем по количеству вершин в модели
 bool Asteroid::isSmall() const {
     return model->getVerts().size() < Constant::asteroidVertCount * 2;
 }
 
 //Разбиваем астероид при столкновении с объектом hitObj
-void Asteroid::Split(const GameObject& hitObj) {
-    Vec2 hitPos = hitObj.getPosition();
+void Asteroid::Split(Vec2 hitPos, Vec2 hitVel) {
     const std::vector<GLfloat>& verts = model->getVerts();
     const std::vector<GLfloat>& tverts = model->getTransformed();
     float minDist = Constant::bigNumber;
     int minInd = 0;
 
-    //Находим ближайшую к hitObj вершину астероида
+    //Находим ближайшую к точке удара вершину астероида
     for(int i = 0; i < verts.size(); i += 2) {
         float dist = Vec2(tverts[i], tverts[i + 1]).getSquaredDist(hitPos);
         if(dist < minDist) {
@@ -181,8 +219,13 @@ void Asteroid::Split(const GameObject& hitObj) {
         swapped = true;
     }
 
+    AllocTracker::Site site("Asteroid::Split");
     //Распределяем вершины текущего астероида по новым
-    std::vector<GLfloat> v1, v2;
+    //Временные массивы живут до конца шага, модели половинок копируют вершины к себе
+    FrameAllocator<GLfloat> alloc(game.GetFrameArena());
+    FrameVector<GLfloat> v1(alloc), v2(alloc);
+    v1.reserve(verts.size() + 2);
+    v2.reserve(verts.size() + 2);
     for(int i = 0; i < verts.size(); i += 2) {
         if(i > minInd && i < maxInd) {
             v1.push_back(verts[i]);
@@ -200,36 +243,36 @@ void Asteroid::Split(const GameObject& hitObj) {
 
     //Скорость новых астероидов определяется скоростью оригинального,
     //скоростью объекта столкновения и направлением разреза
-    Vec2 vel = getVelocity() + hitObj.getVelocity() * Constant::asteroidBulletImpact;
+    Vec2 vel = getVelocity() + hitVel * Constant::asteroidBulletImpact;
     //Смотрим на swapped, чтобы обеспечить разлет половинок в корректном направлении
-    GameObject::Create<Asteroid>(t, std::make_shared<Model>(swapped ? v2 : v1)).setVelocity(vel - orthoVel);
-    GameObject::Create<Asteroid>(t, std::make_shared<Model>(swapped ? v1 : v2)).setVelocity(vel + orthoVel);
+    const FrameVector<GLfloat>& first = swapped ? v2 : v1;
+    const FrameVector<GLfloat>& second = swapped ? v1 : v2;
+    HeapGuard::Exempt exempt;
+    GameObject::Create<Asteroid>(game, t, std::make_shared<Model>(first.data(), first.size())).setVelocity(vel - orthoVel);
+    GameObject::Create<Asteroid>(game, t, std::make_shared<Model>(second.data(), second.size())).setVelocity(vel + orthoVel);
 }
 
-void Asteroid::OnCollision(const GameObject& obj) {
-    switch(obj.getStaticType()) {
-    case GOType::Bullet:
-        if(obj.as<Bullet>().isShotByPlayer()) {
-            //Начисляем очки, только если асетроид уничтожен игроком
-            Game::Get().AddPoints(isSmall() ? Constant::pointsForSmall : Constant::pointsForLarge);
-        }
-    case GOType::Ship:
-        //Большой астероид делим пополам и уничтожаем
-        if(!isSmall()) Split(obj);
-        //Маленький уничтожаем и оповещаем логику
-        GameObject::Create<Explosion>(t);
-        RequestDestruction();
-        if(isSmall()) Game::Get().DecAsteroidCount(*this);
-        return;
-    default:
-        return;
-    };
+void Asteroid::OnHit(const Bullet& bullet) {
+    if(bullet.isShotByPlayer()) {
+        //Начисляем очки, только если асетроид уничтожен игроком
+        game.AddPoints(isSmall() ? Constant::pointsForSmall : Constant::pointsForLarge);
+    }
+    Explode(bullet.getHitPoint(), bullet.getVelocity());
+}
+
+void Asteroid::Explode(Vec2 hitPos, Vec2 hitVel) {
+    //Большой астероид делим пополам и уничтожаем
+    if(!isSmall()) Split(hitPos, hitVel);
+    //Маленький уничтожаем и оповещаем логику
+    game.SpawnExplosion(t.getPos());
+    RequestDestruction();
+    if(isSmall()) game.DecAsteroidCount(*this);
 }
 
 
 ///Bullet///
 
-Bullet::Bullet(const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Bullet) {
+Bullet::Bullet(Game& _game, const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Bullet) {
 
 }
 
@@ -243,68 +286,45 @@ void Bullet::Update(float dt) {
     }
 }
 
-bool Bullet::CollisionMask(GOType type) const {
-    switch(type) {
-    case GOType::Asteroid:
-    case GOType::UFO:
-    case GOType::Ship:
-        return true;
-    default:
-        return false;
-    };
+void Bullet::Save(SnapshotWriter& w) const {
+    GameObject::Save(w);
+    w.Put<uint8_t>(isShotByPl);
+    w.Put(lifetime);
 }
 
-void Bullet::OnCollision(const GameObject& obj) {
-    switch(obj.getStaticType()) {
-    case GOType::Ship:
-        if(isShotByPlayer()) return;
-    case GOType::UFO:
-         if(!isShotByPlayer()) return;
-    case GOType::Asteroid:
-        RequestDestruction();
-        return;
-    default:
-        return;
-    };
-}
-
-
-///Explosion///
-
-Explosion::Explosion(const Transform& pos, std::shared_ptr<Model> mod) : InitBase(Explosion) {
-
+void Bullet::Load(SnapshotReader& r) {
+    GameObject::Load(r);
+    uint8_t byPlayer = 0;
+    r.Get(byPlayer);
+    r.Get(lifetime);
+    isShotByPl = byPlayer != 0;
 }
 
-void Explosion::Update(float dt) {
-    //Квдратично увеличиваем масштаб в течение lifetime секунд
-    lifetime -= dt;
-    float scale = 1 + sqrt(1 - lifetime / Constant::explosionLifetime) * Constant::explosionMaxScale;
-    t.setScale(Vec2(scale, scale));
-    model->ApplyTransform(t);
-    if(lifetime <= 0.f) {
-        RequestDestruction();
-    }
+void Bullet::OnHit(const UFO&) {
+    //Пули НЛО не задевают само НЛО
+    if(isShotByPlayer()) RequestDestruction();
 }
 
 
 ///UFO///
 
-UFO::UFO(const Transform& pos, std::shared_ptr<Model> mod) : InitBase(UFO) {
+UFO::UFO(Game& _game, const Transform& pos, std::shared_ptr<Model> mod) : InitBase(UFO) {
     //НЛО летает горизонтально с постоянной скоростью
     setVelocity(Vec2(Constant::ufoSpeed, 0.f));
     //Чтобы корректно обрабатывать логику перемещений (см Update),
     //НЛО может залетать чуть дальше за границу экрана
     t.setMargin(model->getRadius() + Constant::ufoMargin);
-    Game::Get().OnUfoCreated(*this);
+    game.OnUfoCreated(*this);
 }
 
 void UFO::Update(float dt) {
     Move(dt);
     //При залете за край экрана НЛО меняет направление
     //и выбирает другую горизонтальную линию в пределах ufoZone
-    if(Constant::worldRatio + model->getRadius() - fabs(t.getPos().x) < 0.f) {
+    //(в большом мире без полей до этого не доходит, НЛО облетает тор)
+    if(Constant::worldXExtent + model->getRadius() - fabs(t.getPos().x) < 0.f) {
         std::uniform_real_distribution<float> pos(-Constant::ufoZone, Constant::ufoZone);
-        t.setPos(Vec2(t.getPos().x, pos(Random::generator)));
+        t.setPos(Vec2(t.getPos().x, pos(game.GetRandom().generator)));
         setVelocity(Vec2(-vel.x, 0.f));
     }
 
@@ -312,11 +332,11 @@ void UFO::Update(float dt) {
     if(cooldownTimer <= 0.f) {
         cooldownTimer = Constant::ufoCooldown;
         std::uniform_real_distribution<float> miss(-Constant::ufoAccuracy, Constant::ufoAccuracy);
-        Vec2 missVec = Vec2(miss(Random::generator), miss(Random::generator));
-        Vec2 dir = (Game::Get().GetPlayerPos() + missVec - t.getPos()).getNormalized();
+        Vec2 missVec = Vec2(miss(game.GetRandom().generator), miss(game.GetRandom().generator));
+        Vec2 dir = (game.GetPlayerPos() + missVec - t.getPos()).getNormalized();
         Vec2 spawn = t.getPos() + dir * model->getRadius() * 0.5f;
-        float angle = dir.y > 0 ? acos(dir.x) + M_PI/2 : M_PI/2 - acos(dir.x);
-        Bullet& b = GameObject::Create<Bullet>(spawn.x, spawn.y, angle).as<Bullet>();
+        float angle = FastMath::Atan2(dir.y, dir.x) + FastMath::halfPi;
+        Bullet& b = GameObject::Create<Bullet>(game, spawn.x, spawn.y, angle).as<Bullet>();
         b.setVelocity(dir * Constant::bulletSpeedBasic);
         b.shotByPlayer(false);
     } else {
@@ -324,23 +344,41 @@ void UFO::Update(float dt) {
     }
 }
 
+void UFO::Save(SnapshotWriter& w) const {
+    GameObject::Save(w);
+    w.Put(cooldownTimer);
+}
+
+void UFO::Load(SnapshotReader& r) {
+    GameObject::Load(r);
+    r.Get(cooldownTimer);
+}
+
 //НЛО не сталкивается с астероидами
-bool UFO::CollisionMask(GOType type) const {
-    switch(type) {
-    case GOType::Bullet:
-    case GOType::Ship:
-        return true;
-    default:
-        return false;
-    };
+void UFO::OnHit(const Bullet& bullet) {
+    if(bullet.isShotByPlayer()) Explode();
 }
 
-void UFO::OnCollision(const GameObject& obj) {
-    if(obj.getStaticType() == GOType::Bullet) {
-        if(!obj.as<Bullet>().isShotByPlayer()) return;
-    }
-    GameObject::Create<Explosion>(t);
+void UFO::Explode() {
+    game.SpawnExplosion(t.getPos());
     RequestDestruction();
-    Game::Get().OnUfoDestroyed(*this);
-    Game::Get().AddPoints(Constant::pointsForUFO);
-}
\ No newline at end of file
+    game.OnUfoDestroyed(*this);
+    game.AddPoints(Constant::pointsForUFO);
+}
+
+///Collision dispatch///
+
+namespace {
+    template <int a, int b>
+    constexpr CollisionHandler Handler() {
+        return CollisionPair<static_cast<GOType>(a), static_cast<GOType>(b)>::handler;
+    }
+}
+
+static_assert(goTypeCount == 4, "collisionTable rows are spelled out per GOType");
+const CollisionHandler collisionTable[goTypeCount][goTypeCount] = {
+    {Handler<0, 0>(), Handler<0, 1>(), Handler<0, 2>(), Handler<0, 3>()},
+    {Handler<1, 0>(), Handler<1, 1>(), Handler<1, 2>(), Handler<1, 3>()},
+    {Handler<2, 0>(), Handler<2, 1>(), Handler<2, 2>(), Handler<2, 3>()},
+    {Handler<3, 0>(), Handler<3, 1>(), Handler<3, 2>(), Handler<3, 3>()},
+};
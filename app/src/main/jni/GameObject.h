@@ -3,22 +3,35 @@
 #include <memory>
 
 #include <Renderer.h>
+#include <Snapshot.h>
+#include <AllocTracker.h>
+
+class Game;
+class Ship;
+class Asteroid;
+class Bullet;
+class UFO;
 
 enum class GOType{
-    Ship, Asteroid, UFO, Bullet, Explosion
+    Ship, Asteroid, UFO, Bullet
 };
+constexpr int goTypeCount = 4;
 
 
 ///Base Class///
 
 class GameObject {
-    static int currentId;
     int mId;
+    GOType mType; //кэш getStaticType(), назначается в PushToGame
     bool aboutToDestroy = false;
+    //Пропущенное время и число пропущенных шагов (см. TakeLodStep)
+    float lodTime = 0.f;
+    int lodSkipped = 0;
     void setId(int id) {mId = id;};
-    static GameObject& PushToGame(std::unique_ptr<GameObject>&& obj);
+    static GameObject& PushToGame(Game& game, std::unique_ptr<GameObject>&& obj);
 
 protected:
+    Game& game; //какой игре принадлежит объект
     Vec2 vel;
     Transform t; //где отрисовываем
     std::shared_ptr<Model> model; //что отрисовываем
@@ -27,7 +40,7 @@ protected:
     void Rotate(float deltaAngle);
 
     //Нельзя создать вне метода Create
-    GameObject(const Transform& pos, std::shared_ptr<Model> mod);
+    GameObject(Game& _game, const Transform& pos, std::shared_ptr<Model> mod);
 
     //Нельзя удалить, не удалив unique_ptr
     virtual ~GameObject();
@@ -38,40 +51,49 @@ public:
     GameObject(const GameObject&) = delete;
     GameObject& operator=(const GameObject&) = delete;
 
-    //Создаём объект производного типа, назначем уникальный id, передаем в Game, возвращаем ссылку
+    //Создаём объект производного типа, передаем в game (там назначается уникальный id), возвращаем ссылку
     template <class T>
-    static GameObject& Create(const Transform& pos, std::shared_ptr<Model> mod = nullptr) {
-        auto obj = std::unique_ptr<GameObject>(new T(pos, mod));;
-        currentId++;
-        obj->setId(currentId);
-        return PushToGame(std::move(obj));
+    static GameObject& Create(Game& game, const Transform& pos, std::shared_ptr<Model> mod = nullptr) {
+        AllocTracker::Site site("GameObject::Create");
+        HeapGuard::Exempt exempt;
+        return PushToGame(game, std::unique_ptr<GameObject>(new T(game, pos, mod)));
     };
 
     template <class T>
-    static GameObject& Create(float x = 0.f, float y = 0.f, float a = 0.f, std::shared_ptr<Model> mod = nullptr) {
-        return Create<T>(Transform(x, y, a), mod);
+    static GameObject& Create(Game& game, float x = 0.f, float y = 0.f, float a = 0.f, std::shared_ptr<Model> mod = nullptr) {
+        return Create<T>(game, Transform(x, y, a), mod);
     };
 
     //Потенциально небезопасное привидение, но синтаксис призван не дать запутаться
     template <class T> T& as() { return *static_cast<T*>(this); }
     template <class T> const T& as() const { return *static_cast<const T*>(this); }
 
+    //Дальние от игрока объекты большого мира обновляются раз в Constant::simLodInterval шагов
+    //false - шаг пропускается, иначе в stepDt время с последнего обновления
+    bool TakeLodStep(float dt, const Vec2& playerPos, float& stepDt);
+
     //Запросить удаление объекта в ближайшем Update
     void RequestDestruction();
     bool isDestructionRequested() const { return aboutToDestroy; };
 
     int getId() const { return mId; };
+    GOType getType() const { return mType; };
     void setVelocity(const Vec2& velocity) { vel = velocity; };
     Vec2 getVelocity() const { return vel; };
     Vec2 getPosition() const { return t.getPos(); };
+    float getAngle() const { return t.getAngle(); };
     float getRadius() const { return model->getRadius(); };
     const Model& getModel() const { return *model; };
 
     virtual GOType getStaticType() const = 0; //Нельзя создать объект
     virtual void Update(float dt) { Move(dt); };
-    //Вернуть true, если требуется обработка столкновений
-    virtual bool CollisionMask(GOType type) const {return false;};
-    virtual void OnCollision(const GameObject& obj) { RequestDestruction(); };
+    //Столкновения обрабатываются невиртуальными OnHit производных классов
+    //через collisionTable (см. конец файла)
+
+    //Снимок состояния объекта (модель пишет Game, см. Game::SaveSnapshot)
+    //Производные классы дописывают свои таймеры после базовых полей
+    virtual void Save(SnapshotWriter& w) const;
+    virtual void Load(SnapshotReader& r);
 };
 
 
@@ -89,33 +111,40 @@ class Ship : public GameObject {
     float pointsTimer = Constant::pointsTimeInterval;
     std::shared_ptr<Model> engine;
 
+    void Explode();
+
 protected:
     friend class GameObject;
-    Ship(const Transform& pos, std::shared_ptr<Model> mod);
+    Ship(Game& _game, const Transform& pos, std::shared_ptr<Model> mod);
     virtual ~Ship();
 
 public:
     GOType getStaticType() const override {return GOType::Ship;};
     void Update (float dt) override;
-    bool CollisionMask(GOType type) const override;
-    void OnCollision(const GameObject& obj) override;
+    void OnHit(const Asteroid&) {Explode();};
+    void OnHit(const UFO&) {Explode();};
+    void OnHit(const Bullet& bullet);
+    void Save(SnapshotWriter& w) const override;
+    void Load(SnapshotReader& r) override;
 };
 
 
 ///Asteroid///
 
 class Asteroid : public GameObject {
-    void Split(const GameObject& hitObj);
+    friend class Benchmark;
+    void Split(Vec2 hitPos, Vec2 hitVel);
+    void Explode(Vec2 hitPos, Vec2 hitVel);
 
 protected:
     friend class GameObject;
-    Asteroid(const Transform& pos, std::shared_ptr<Model> mod);
+    Asteroid(Game& _game, const Transform& pos, std::shared_ptr<Model> mod);
     virtual ~Asteroid() {};
 
 public:
     GOType getStaticType() const override {return GOType::Asteroid;};
-    bool CollisionMask(GOType type) const override;
-    void OnCollision(const GameObject& obj) override;
+    void OnHit(const Ship& ship) {Explode(ship.getPosition(), ship.getVelocity());};
+    void OnHit(const Bullet& bullet);
 
     bool isSmall() const;
 };
@@ -126,52 +155,95 @@ public:
 class Bullet : public GameObject {
     bool isShotByPl = false;
     float lifetime = Constant::bulletLifetime;
+    Vec2 hitPoint; //где пуля задела цель в последнем столкновении
 
 protected:
     friend class GameObject;
-    Bullet(const Transform& pos, std::shared_ptr<Model> mod);
+    Bullet(Game& _game, const Transform& pos, std::shared_ptr<Model> mod);
     virtual ~Bullet() {};
 
 public:
     GOType getStaticType() const override {return GOType::Bullet;};
     void Update (float dt) override;
-    bool CollisionMask(GOType type) const override;
-    void OnCollision(const GameObject& obj) override;
+    void OnHit(const Asteroid&) {RequestDestruction();};
+    void OnHit(const UFO&);
+    //Пуля НЛО, попавшая в корабль, летит дальше, пуля игрока его не задевает
+    void OnHit(const Ship&) {};
+
+    void Save(SnapshotWriter& w) const override;
+    void Load(SnapshotReader& r) override;
 
     void shotByPlayer(bool isIt = true) {isShotByPl = isIt;};
     bool isShotByPlayer() const {return isShotByPl;};
+    void setHitPoint(const Vec2& point) {hitPoint = point;};
+    Vec2 getHitPoint() const {return hitPoint;};
 };
 
 
-///Explosion///
+///UFO///
 
-class Explosion : public GameObject {
-    float lifetime = Constant::explosionLifetime;
+class UFO : public GameObject {
+    float cooldownTimer = Constant::ufoCooldown;
+
+    void Explode();
 
 protected:
     friend class GameObject;
-    Explosion(const Transform& pos, std::shared_ptr<Model> mod);
-    virtual ~Explosion() {};
+    UFO(Game& _game, const Transform& pos, std::shared_ptr<Model> mod);
+    virtual ~UFO() {};
 
 public:
-    GOType getStaticType() const override {return GOType::Explosion;};
+    GOType getStaticType() const override {return GOType::UFO;};
     void Update (float dt) override;
+    void OnHit(const Ship&) {Explode();};
+    void OnHit(const Bullet& bullet);
+    void Save(SnapshotWriter& w) const override;
+    void Load(SnapshotReader& r) override;
 };
 
 
-///UFO///
+///Collision dispatch///
 
-class UFO : public GameObject {
-    float cooldownTimer = Constant::ufoCooldown;
+//Обработчик столкновения пары объектов, типы которых известны заранее
+typedef void (*CollisionHandler)(GameObject& a, GameObject& b);
 
-protected:
-    friend class GameObject;
-    UFO(const Transform& pos, std::shared_ptr<Model> mod);
-    virtual ~UFO() {};
+//Какие пары типов сталкиваются. Порядок строк и столбцов - как в GOType
+constexpr bool collisionMask[goTypeCount][goTypeCount] = {
+    //Ship   Asteroid UFO    Bullet
+    {false,  true,    true,  true }, //Ship
+    {true,   false,   false, true }, //Asteroid
+    {true,   false,   false, true }, //UFO
+    {true,   true,    true,  false}, //Bullet
+};
 
-public:
-    GOType getStaticType() const override {return GOType::UFO;};
-    void Update (float dt) override;
-    bool CollisionMask(GOType type) const override;
-    void OnCollision(const GameObject& obj) override;
-};
\ No newline at end of file
+template <GOType type> struct GOClass;
+template <> struct GOClass<GOType::Ship> {typedef Ship type;};
+template <> struct GOClass<GOType::Asteroid> {typedef Asteroid type;};
+template <> struct GOClass<GOType::UFO> {typedef UFO type;};
+template <> struct GOClass<GOType::Bullet> {typedef Bullet type;};
+
+//Для пары из collisionMask оба объекта получают OnHit с точным типом другого.
+//Если для такой пары нет подходящего OnHit, это ошибка компиляции.
+//Для остальных пар обработчика нет (nullptr)
+template <GOType A, GOType B, bool = collisionMask[static_cast<int>(A)][static_cast<int>(B)]>
+struct CollisionPair {
+    static constexpr CollisionHandler handler = nullptr;
+};
+
+template <GOType A, GOType B>
+struct CollisionPair<A, B, true> {
+    static_assert(collisionMask[static_cast<int>(B)][static_cast<int>(A)], "collisionMask must be symmetric");
+    typedef typename GOClass<A>::type TA;
+    typedef typename GOClass<B>::type TB;
+
+    static void Handle(GameObject& a, GameObject& b) {
+        TA& ta = a.as<TA>();
+        TB& tb = b.as<TB>();
+        ta.OnHit(tb);
+        tb.OnHit(ta);
+    };
+    static constexpr CollisionHandler handler = &Handle;
+};
+
+//collisionTable[a.getType()][b.getType()] - обработчик или nullptr (GameObject.cpp)
+extern const CollisionHandler collisionTable[goTypeCount][goTypeCount];
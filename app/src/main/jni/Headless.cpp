@@ -0,0 +1,179 @@
+#include <Headless.h>
+#include <Game.h>
+#include <Benchmark.h>
+#include <FastMath.h>
+
+#include <cstdio>
+
+#include <vector>
+
+//Игра без платформы: вибрации нет, рекорд живёт только в памяти
+struct AsteroidsSim {
+    Game game;
+    explicit AsteroidsSim(unsigned seed) : game(seed) {
+        game.Reset(seed);
+    }
+};
+
+AsteroidsSim* asteroids_create(unsigned seed) {
+    return new AsteroidsSim(seed);
+}
+
+void asteroids_step(AsteroidsSim* sim, const AsteroidsAction* action, float dt) {
+    Controls& controls = sim->game.GetControls();
+    if(action) {
+        controls.SetInput(action->forward, action->horAxis, action->shooting != 0, action->teleport != 0);
+    } else {
+        controls.SetInput(0.f, 0.f, false, false);
+    }
+    sim->game.Step(dt);
+}
+
+void asteroids_observe(AsteroidsSim* sim, AsteroidsObservation* obs) {
+    Game& game = sim->game;
+    int n = 0, total = 0;
+    bool alive = false;
+    for(auto& go : game.GetObjects()) {
+        if(go->isDestructionRequested()) continue;
+        total++;
+        GOType type = go->getStaticType();
+        if(type == GOType::Ship) alive = true;
+        if(n < obs->capacity) {
+            Vec2 pos = go->getPosition();
+            Vec2 vel = go->getVelocity();
+            if(obs->posX) obs->posX[n] = pos.x;
+            if(obs->posY) obs->posY[n] = pos.y;
+            if(obs->velX) obs->velX[n] = vel.x;
+            if(obs->velY) obs->velY[n] = vel.y;
+            if(obs->radius) obs->radius[n] = go->getRadius();
+            if(obs->type) obs->type[n] = static_cast<int>(type);
+            n++;
+        }
+    }
+    obs->count = n;
+    obs->total = total;
+    obs->score = game.GetScore().getScore();
+    obs->highScore = game.GetScore().getHighScore();
+    obs->alive = alive;
+    obs->running = game.IsRunning();
+}
+
+void asteroids_reset(AsteroidsSim* sim, unsigned seed) {
+    sim->game.Reset(seed);
+}
+
+void asteroids_destroy(AsteroidsSim* sim) {
+    delete sim;
+}
+
+void asteroids_set_broad_phase(AsteroidsSim* sim, int phase) {
+    sim->game.SetBroadPhase(phase == ASTEROIDS_BROAD_SWEEP_AND_PRUNE ?
+                            BroadPhase::SweepAndPrune : BroadPhase::AllPairs);
+}
+
+int asteroids_benchmark(const char* filter, const char* jsonPath) {
+    std::vector<Benchmark::Result> results = Benchmark::Run(filter ? filter : "");
+    Benchmark::Log(results);
+    if(jsonPath) {
+        FILE* f = fopen(jsonPath, "w");
+        if(f) {
+            std::string json = Benchmark::ToJson(results);
+            fwrite(json.data(), 1, json.size(), f);
+            fclose(f);
+        }
+    }
+    return results.size();
+}
+
+int asteroids_check_frame_pacing(void) {
+    return FramePacer::SelfCheck();
+}
+
+int asteroids_check_fast_math(void) {
+    return FastMath::CheckAccuracy();
+}
+
+int asteroids_record_start(AsteroidsSim* sim, const char* path, int keyframeInterval) {
+    if(keyframeInterval <= 0) keyframeInterval = Constant::recordKeyframeInterval;
+    return sim->game.StartRecording(path, keyframeInterval);
+}
+
+void asteroids_record_stop(AsteroidsSim* sim) {
+    sim->game.StopRecording();
+}
+
+
+///AsteroidsBatch///
+
+//Игры пакета хранятся и шагают по порядку, чтобы результат не зависел от числа потоков
+struct AsteroidsBatch {
+    std::vector<std::unique_ptr<AsteroidsSim>> sims;
+};
+
+namespace {
+    template <class T>
+    T* Offset(T* p, int offset) {
+        return p ? p + offset : nullptr;
+    }
+
+    template <class T>
+    void Store(T* p, int k, T value) {
+        if(p) p[k] = value;
+    }
+}
+
+AsteroidsBatch* asteroids_batch_create(int count, unsigned seed) {
+    AsteroidsBatch* batch = new AsteroidsBatch();
+    batch->sims.reserve(count);
+    for(int k = 0; k < count; ++k) {
+        batch->sims.emplace_back(new AsteroidsSim(seed + k));
+    }
+    return batch;
+}
+
+int asteroids_batch_size(const AsteroidsBatch* batch) {
+    return batch->sims.size();
+}
+
+void asteroids_batch_step(AsteroidsBatch* batch, const AsteroidsAction* actions,
+                          const unsigned char* mask, float dt) {
+    const int count = asteroids_batch_size(batch);
+    for(int k = 0; k < count; ++k) {
+        if(mask && !mask[k]) continue;
+        asteroids_step(batch->sims[k].get(), actions ? &actions[k] : nullptr, dt);
+    }
+}
+
+void asteroids_batch_observe(AsteroidsBatch* batch, AsteroidsBatchObservation* obs) {
+    const int count = asteroids_batch_size(batch);
+    for(int k = 0; k < count; ++k) {
+        int first = k * obs->capacity;
+        AsteroidsObservation o;
+        o.capacity = obs->capacity;
+        o.posX = Offset(obs->posX, first);
+        o.posY = Offset(obs->posY, first);
+        o.velX = Offset(obs->velX, first);
+        o.velY = Offset(obs->velY, first);
+        o.radius = Offset(obs->radius, first);
+        o.type = Offset(obs->type, first);
+        asteroids_observe(batch->sims[k].get(), &o);
+        Store(obs->objectCount, k, o.count);
+        Store(obs->total, k, o.total);
+        Store(obs->score, k, o.score);
+        Store(obs->highScore, k, o.highScore);
+        Store(obs->alive, k, o.alive);
+        Store(obs->running, k, o.running);
+    }
+}
+
+void asteroids_batch_reset(AsteroidsBatch* batch, const unsigned char* mask, unsigned seed) {
+    const int count = asteroids_batch_size(batch);
+    for(int k = 0; k < count; ++k) {
+        if(mask && !mask[k]) continue;
+        asteroids_reset(batch->sims[k].get(), seed + k);
+    }
+}
+
+void asteroids_batch_destroy(AsteroidsBatch* batch) {
+    delete batch;
+}
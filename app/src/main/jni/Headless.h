@@ -0,0 +1,119 @@
+#pragma once
+
+//C API симуляции без отрисовки и JNI: боты, подбор значений Constant
+//Каждый экземпляр независим, разные экземпляры можно шагать из разных потоков
+//Массивы наблюдения выделяет вызывающая сторона, observe ничего не выделяет
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AsteroidsSim AsteroidsSim;
+
+//Соответствует вводу Controls
+typedef struct {
+    float forward;  //0..1
+    float horAxis;  //-1..1, положительное значение - поворот влево
+    int shooting;
+    int teleport;
+} AsteroidsAction;
+
+//Совпадают с GOType
+enum {
+    ASTEROIDS_SHIP = 0,
+    ASTEROIDS_ASTEROID = 1,
+    ASTEROIDS_UFO = 2,
+    ASTEROIDS_BULLET = 3
+};
+
+typedef struct {
+    //Заполняет вызывающий: ёмкость массивов, любой из них может быть NULL
+    int capacity;
+    float* posX;
+    float* posY;
+    float* velX;
+    float* velY;
+    float* radius;
+    int* type;
+
+    //Заполняет симуляция
+    int count;      //записано объектов, не больше capacity
+    int total;      //всего объектов в мире
+    int score;
+    int highScore;
+    int alive;      //корабль игрока существует
+    int running;    //уровень не на паузе
+} AsteroidsObservation;
+
+AsteroidsSim* asteroids_create(unsigned seed);
+//action == NULL - ничего не нажато
+void asteroids_step(AsteroidsSim* sim, const AsteroidsAction* action, float dt);
+void asteroids_observe(AsteroidsSim* sim, AsteroidsObservation* obs);
+//Новый уровень с новым зерном, рекорд сохраняется
+void asteroids_reset(AsteroidsSim* sim, unsigned seed);
+void asteroids_destroy(AsteroidsSim* sim);
+
+//Широкая фаза столкновений (см. BroadPhase), переключается между шагами
+enum {
+    ASTEROIDS_BROAD_ALL_PAIRS = 0,
+    ASTEROIDS_BROAD_SWEEP_AND_PRUNE = 1
+};
+void asteroids_set_broad_phase(AsteroidsSim* sim, int phase);
+
+//Микробенчмарки (см. Benchmark.h), filter - подстрока имени (NULL - все)
+//Результаты пишутся в лог и, если jsonPath не NULL, в файл JSON. Возвращает число бенчмарков
+int asteroids_benchmark(const char* filter, const char* jsonPath);
+
+//Проверка шага по vsync на синтетических данных (см. FramePacer::SelfCheck)
+//Результаты пишутся в лог, возвращает число проваленных случаев
+int asteroids_check_frame_pacing(void);
+
+//Точность FastMath относительно libm (см. FastMath::CheckAccuracy)
+//Результаты пишутся в лог, возвращает число функций с погрешностью выше заявленной
+int asteroids_check_fast_math(void);
+
+//Запись партии в файл (см. Recording.h), keyframeInterval <= 0 - значение по умолчанию
+//Возвращает 0 при ошибке открытия файла
+int asteroids_record_start(AsteroidsSim* sim, const char* path, int keyframeInterval);
+void asteroids_record_stop(AsteroidsSim* sim);
+
+
+//Пакет из count игр, которые шагают синхронно одним вызовом
+//Экземпляр k получает зерно seed + k
+typedef struct AsteroidsBatch AsteroidsBatch;
+
+//Наблюдение всего пакета в виде структуры массивов
+typedef struct {
+    //Заполняет вызывающий: capacity объектов на экземпляр,
+    //массивы объектов размером count * capacity (экземпляр k начинается с k * capacity),
+    //массивы состояния размером count. Любой указатель может быть NULL
+    int capacity;
+    float* posX;
+    float* posY;
+    float* velX;
+    float* velY;
+    float* radius;
+    int* type;
+
+    int* objectCount;
+    int* total;
+    int* score;
+    int* highScore;
+    int* alive;
+    int* running;
+} AsteroidsBatchObservation;
+
+AsteroidsBatch* asteroids_batch_create(int count, unsigned seed);
+int asteroids_batch_size(const AsteroidsBatch* batch);
+//actions - массив из count действий (NULL - ничего не нажато)
+//mask - массив из count флагов, экземпляры с 0 пропускают шаг (NULL - шагают все)
+void asteroids_batch_step(AsteroidsBatch* batch, const AsteroidsAction* actions,
+                          const unsigned char* mask, float dt);
+void asteroids_batch_observe(AsteroidsBatch* batch, AsteroidsBatchObservation* obs);
+//Перезапускает экземпляры с ненулевым флагом в mask (NULL - все), экземпляр k получает seed + k
+void asteroids_batch_reset(AsteroidsBatch* batch, const unsigned char* mask, unsigned seed);
+void asteroids_batch_destroy(AsteroidsBatch* batch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+//Связь игры с платформой: вибрация и хранение рекорда
+//По умолчанию рекорд хранится только в памяти, вибрации нет (например, для игр без экрана),
+//реализация для Android - в Wrapper.cpp
+class Platform {
+    int highScore = 0;
+public:
+    virtual ~Platform() {};
+
+    virtual int ReadHighScore() {return highScore;};
+    virtual void SubmitHighScore(int score) {highScore = score;};
+    //Записать рекорд в постоянное хранилище
+    virtual void FlushHighScore() {};
+    virtual void Vibrate() {};
+};
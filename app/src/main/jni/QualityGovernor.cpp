@@ -0,0 +1,65 @@
+#include <QualityGovernor.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const char* const stageNames[] = {
+        "full", "fewer spikes", "decimated outlines", "coarse collisions", "no line smoothing", "half frame rate"
+    };
+}
+
+//Бюджет - период экрана, с ограничением частоты - целое число периодов не меньше ограничения
+float QualityGovernor::Budget() const {
+    if(!has(QualityStage::HalfFrameRate)) return period;
+    return period * std::max(1.0f, std::ceil(Constant::governorCappedFrameTime / period - 0.01f));
+}
+
+void QualityGovernor::SetLevel(int newLevel, const char* reason) {
+    LOGI("Quality %d -> %d (%s), %s: frame %.2f ms, sim %.2f ms, collision %.2f ms, render %.2f ms, budget %.2f ms",
+         level, newLevel, stageNames[newLevel], reason, avg.frame * 1000.0f, avg.sim * 1000.0f,
+         avg.collision * 1000.0f, avg.render * 1000.0f, Budget() * 1000.0f);
+    level = newLevel;
+    fastFrames = 0;
+    cooldown = Constant::governorCooldownFrames;
+}
+
+bool QualityGovernor::OnFrame(const Timings& t, float displayPeriod, bool canReduce) {
+    if(t.frame <= 0.0f || t.frame > Constant::dynResMaxFrameTime) return false;
+    if(displayPeriod > 0.0f) period = displayPeriod;
+    if(avg.frame == 0.0f) avg = t;
+    const float k = 0.05f;
+    avg.frame += (t.frame - avg.frame) * k;
+    avg.sim += (t.sim - avg.sim) * k;
+    avg.collision += (t.collision - avg.collision) * k;
+    avg.render += (t.render - avg.render) * k;
+    if(cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    const int maxLevel = static_cast<int>(QualityStage::Count) - 1;
+    if(avg.frame > Budget() * Constant::governorSlowRatio) {
+        fastFrames = 0;
+        if(!canReduce || level == maxLevel) return false;
+        if(probing) upWait = std::min(upWait * 2, Constant::governorMaxUpFrames);
+        probing = false;
+        SetLevel(level + 1, "frame over budget");
+        return true;
+    }
+
+    const float work = avg.sim + avg.collision + avg.render;
+    const bool headroom = avg.frame < Budget() * Constant::dynResFastRatio &&
+                          work < period * Constant::governorWorkRatio;
+    fastFrames = headroom ? fastFrames + 1 : 0;
+    if(probing && fastFrames >= Constant::governorUpFrames) {
+        probing = false;
+        upWait = Constant::governorUpFrames;
+    }
+    if(level > 0 && fastFrames >= upWait) {
+        probing = true;
+        SetLevel(level - 1, "headroom");
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Utils.h>
+
+//Ступени снижения качества, каждая следующая включает предыдущие
+enum class QualityStage : int {
+    Full,
+    FewerSpikes,        //взрывы с каждым Constant::governorSpikeStep-м лучом
+    DecimatedOutlines,  //контуры астероидов рисуются через вершину
+    CoarseCollisions,   //пары мелких объектов сталкиваются по окружностям, без RefineCollision
+    NoLineSmoothing,    //линии без сглаживания (его стоимость - лишний пиксель с каждой стороны)
+    HalfFrameRate,      //кадр не чаще Constant::governorCappedFrameTime
+    Count
+};
+
+//Выбор ступени качества по времени кадра, по той же схеме, что и DynamicResolution:
+//при превышении бюджета - ступень вниз, при долгом запасе - пробная ступень вверх,
+//неудачная проба вдвое откладывает следующую. Запас определяется по времени работы
+//на CPU (симуляция, столкновения, отрисовка), потому что период кадра при vsync его не покажет.
+//Качество снижается только после разрешения (см. Renderer::IsResolutionAtMin)
+class QualityGovernor {
+public:
+    //Время фаз кадра в секундах
+    struct Timings {
+        float frame;      //период кадра
+        float sim;        //шаг без столкновений
+        float collision;
+        float render;
+    };
+
+private:
+    int level = 0;
+    Timings avg = {0.0f, 0.0f, 0.0f, 0.0f}; //avg.frame == 0 - кадров еще не было
+    float period = 1.0f / Constant::defaultRefreshRate; //период обновления экрана
+    int fastFrames = 0;
+    int cooldown = 0;
+    int upWait = Constant::governorUpFrames;
+    bool probing = false;
+
+    float Budget() const;
+    void SetLevel(int newLevel, const char* reason);
+
+public:
+    //Возвращает true, если ступень изменилась. canReduce == false - сначала снижается разрешение
+    //displayPeriod - период обновления экрана (FramePacer), бюджет кадра считается от него
+    bool OnFrame(const Timings& t, float displayPeriod, bool canReduce);
+    int getLevel() const {return level;};
+    bool has(QualityStage stage) const {return level >= static_cast<int>(stage);};
+};
@@ -0,0 +1,561 @@
+#include <Recording.h>
+#include <Game.h>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    //Положение хранится с 16 дробными битами шага квантования
+    constexpr int fracBits = 16;
+    //Шагов положения за секунду на единицу скорости, умноженное на 2^fracBits
+    constexpr int64_t velToPos = (int64_t(Constant::recordPosScale) << fracBits) / Constant::recordVelScale;
+
+    //Флаги изменений объекта в дельта-кадре
+    enum : uint8_t {
+        changedPos = 1,
+        changedVel = 2,
+        changedAngle = 4
+    };
+
+    template <class Buffer>
+    void PutVarint(Buffer& b, uint64_t v) {
+        while(v >= 0x80) {
+            b.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        b.push_back(static_cast<unsigned char>(v));
+    }
+
+    //zigzag: маленькие по модулю отрицательные числа тоже занимают один байт
+    template <class Buffer>
+    void PutSigned(Buffer& b, int64_t v) {
+        PutVarint(b, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    bool GetVarint(const unsigned char* data, size_t size, size_t& pos, uint64_t& v) {
+        v = 0;
+        for(int shift = 0; shift < 64 && pos < size; shift += 7) {
+            unsigned char c = data[pos++];
+            v |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if(!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool GetSigned(const unsigned char* data, size_t size, size_t& pos, int64_t& v) {
+        uint64_t u;
+        if(!GetVarint(data, size, pos, u)) return false;
+        v = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+        return true;
+    }
+
+    int64_t QuantPos(float p) {
+        return llroundf(p * Constant::recordPosScale);
+    }
+
+    int64_t ToFixed(int64_t q) {
+        return q * (int64_t(1) << fracBits);
+    }
+
+    int64_t RoundPos(int64_t fp) {
+        return (fp + (int64_t(1) << (fracBits - 1))) >> fracBits;
+    }
+
+    Recording::ObjectState Quantize(const GameObject& go) {
+        Recording::ObjectState s;
+        s.type = static_cast<uint8_t>(go.getStaticType());
+        s.x = ToFixed(QuantPos(go.getPosition().x));
+        s.y = ToFixed(QuantPos(go.getPosition().y));
+        s.vx = lroundf(go.getVelocity().x * Constant::recordVelScale);
+        s.vy = lroundf(go.getVelocity().y * Constant::recordVelScale);
+        s.angle = static_cast<uint16_t>(llroundf(go.getAngle() * (65536.f / (2.f * M_PI))) & 0xFFFF);
+        return s;
+    }
+
+    void PutObject(std::vector<unsigned char>& b, const Recording::ObjectState& s) {
+        b.push_back(s.type);
+        PutSigned(b, RoundPos(s.x));
+        PutSigned(b, RoundPos(s.y));
+        PutSigned(b, s.vx);
+        PutSigned(b, s.vy);
+        PutVarint(b, s.angle);
+    }
+
+    bool GetObject(const unsigned char* data, size_t size, size_t& pos, Recording::ObjectState& s) {
+        int64_t x, y, vx, vy;
+        uint64_t angle;
+        if(pos >= size) return false;
+        s.type = data[pos++];
+        if(!GetSigned(data, size, pos, x) || !GetSigned(data, size, pos, y) ||
+           !GetSigned(data, size, pos, vx) || !GetSigned(data, size, pos, vy) ||
+           !GetVarint(data, size, pos, angle)) return false;
+        s.x = ToFixed(x);
+        s.y = ToFixed(y);
+        s.vx = vx;
+        s.vy = vy;
+        s.angle = angle;
+        return true;
+    }
+}
+
+void Recording::Advance(ObjectState& s, uint32_t dtUs) {
+    s.x += int64_t(s.vx) * dtUs * velToPos / 1000000;
+    s.y += int64_t(s.vy) * dtUs * velToPos / 1000000;
+}
+
+
+///Recorder///
+
+namespace {
+    //Рост буферов записи - редкое событие (больше объектов или кадров, чем было), его HeapGuard не считает
+    template <class T>
+    void ReserveFor(std::vector<T>& v, size_t extra) {
+        if(v.size() + extra <= v.capacity()) return;
+        HeapGuard::Exempt exempt;
+        v.reserve(std::max(v.capacity() * 2, v.size() + extra));
+    }
+
+    //Верхняя оценка байт на объект в кадре: id, тип, четыре числа и угол
+    constexpr size_t maxObjectBytes = 64;
+}
+
+Recorder::~Recorder() {
+    Close();
+}
+
+bool Recorder::Open(const std::string& path, int interval) {
+    Close();
+    file = fopen(path.c_str(), "w+b");
+    if(!file) return false;
+    keyframeInterval = std::max(1, interval);
+    frameCount = 0;
+    writePos = filePos = sizeof(Recording::Header);
+    indexWritten = false;
+    keyframes.clear();
+    objects.clear();
+    pending.clear();
+    writing.clear();
+    //Память на всё сразу, чтобы Record не выделял ее в кадре
+    keyframes.reserve(1024);
+    objects.reserve(Constant::collisionReserve);
+    frame.reserve(Constant::collisionReserve * maxObjectBytes);
+    pending.reserve(Constant::recordWriteBytes * 2);
+    writing.reserve(Constant::recordWriteBytes * 2);
+    WriteHeader(0, 0);
+    stop = false;
+    writer = std::thread(&Recorder::RunWriter, this);
+    return true;
+}
+
+void Recorder::Close() {
+    if(file) {
+        Flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        writer.join();
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+//indexOffset == 0 - индекса нет, читатель восстановит его проходом по кадрам
+void Recorder::WriteHeader(uint64_t indexOffset, uint32_t frames) {
+    Recording::Header h;
+    h.magic = Recording::magic;
+    h.version = Recording::version;
+    h.keyframeInterval = keyframeInterval;
+    h.frameCount = frames;
+    h.indexOffset = indexOffset;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, file);
+}
+
+void Recorder::WriteFrames(const std::vector<unsigned char>& data) {
+    //Индекс после Flush затирается кадрами. Если процесс убьют до следующего Flush,
+    //заголовок без индекса и обрезанный хвост позволят прочитать всё записанное
+    if(indexWritten) {
+        WriteHeader(0, 0);
+        fflush(file);
+        if(ftruncate(fileno(file), filePos) != 0) LOGW("Recording: failed to truncate the index");
+        indexWritten = false;
+    }
+    fseek(file, filePos, SEEK_SET);
+    fwrite(data.data(), 1, data.size(), file);
+    filePos += data.size();
+}
+
+void Recorder::RunWriter() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        cv.wait(lock, [this]() { return stop || !writing.empty(); });
+        if(writing.empty()) return;
+        //Пока поток пишет, Record копит следующую порцию в pending
+        lock.unlock();
+        WriteFrames(writing);
+        lock.lock();
+        writing.clear();
+        cv.notify_all();
+    }
+}
+
+void Recorder::Flush() {
+    if(!file) return;
+    //Дожидаемся потока записи, дальше он ждет новую порцию и файл не трогает
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return writing.empty(); });
+    if(indexWritten && pending.empty()) return;
+    WriteFrames(pending);
+    pending.clear();
+    fseek(file, filePos, SEEK_SET);
+    fwrite(keyframes.data(), sizeof(uint64_t), keyframes.size(), file);
+    WriteHeader(filePos, frameCount);
+    fflush(file);
+    indexWritten = true;
+}
+
+void Recorder::Record(const Game& game, float dt) {
+    if(!file) return;
+
+    uint32_t dtUs = static_cast<uint32_t>(std::max(0.f, dt) * 1e6f + 0.5f);
+    frame.clear();
+    ReserveFor(frame, 32 + (objects.size() + game.GetObjects().size()) * maxObjectBytes);
+    if(frameCount % keyframeInterval == 0) {
+        ReserveFor(keyframes, 1);
+        keyframes.push_back(writePos);
+        WriteKeyframe(game, dtUs);
+    } else {
+        WriteDelta(game, dtUs);
+    }
+
+    //Кадр: длина, затем данные
+    const size_t start = pending.size();
+    ReserveFor(pending, frame.size() + 10);
+    PutVarint(pending, frame.size());
+    pending.insert(pending.end(), frame.begin(), frame.end());
+    writePos += pending.size() - start;
+    frameCount++;
+
+    //Поток записи занят - порция подождет следующего кадра
+    if(pending.size() >= static_cast<size_t>(Constant::recordWriteBytes)) {
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if(lock.owns_lock() && writing.empty()) {
+            std::swap(pending, writing);
+            cv.notify_all();
+        }
+    }
+}
+
+Recorder::TrackedObject* Recorder::Find(int id) {
+    auto it = std::lower_bound(objects.begin(), objects.end(), id,
+                               [](const TrackedObject& o, int id) { return o.id < id; });
+    return it != objects.end() && it->id == id ? &*it : nullptr;
+}
+
+void Recorder::WriteKeyframe(const Game& game, uint32_t dtUs) {
+    objects.clear();
+    for(auto& go : game.GetObjects()) {
+        if(go->isDestructionRequested()) continue;
+        ReserveFor(objects, 1);
+        objects.push_back(TrackedObject{go->getId(), Quantize(*go)});
+    }
+    std::sort(objects.begin(), objects.end(),
+              [](const TrackedObject& l, const TrackedObject& r) { return l.id < r.id; });
+    lastScore = game.GetScore().getScore();
+
+    PutVarint(frame, dtUs);
+    PutSigned(frame, lastScore);
+    PutVarint(frame, objects.size());
+    int prevId = 0;
+    for(auto& o : objects) {
+        PutVarint(frame, o.id - prevId);
+        prevId = o.id;
+        PutObject(frame, o.state);
+    }
+}
+
+void Recorder::WriteDelta(const Game& game, uint32_t dtUs) {
+    //Списки кадра живут в FrameArena игры
+    FrameAllocator<int> alloc(game.GetFrameArena());
+    FrameMap<int, Recording::ObjectState> current(std::less<int>(), alloc);
+    for(auto& go : game.GetObjects()) {
+        if(!go->isDestructionRequested()) current[go->getId()] = Quantize(*go);
+    }
+    int32_t score = game.GetScore().getScore();
+
+    PutVarint(frame, dtUs);
+    PutSigned(frame, score - lastScore);
+    lastScore = score;
+
+    //Уничтоженные
+    FrameVector<int> gone(alloc);
+    for(auto& o : objects) {
+        if(!current.count(o.id)) gone.push_back(o.id);
+    }
+    PutVarint(frame, gone.size());
+    int prevId = 0;
+    for(int id : gone) {
+        PutVarint(frame, id - prevId);
+        prevId = id;
+    }
+    if(!gone.empty()) {
+        objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                     [&current](const TrackedObject& o) { return !current.count(o.id); }),
+                      objects.end());
+    }
+
+    for(auto& o : objects) {
+        Recording::Advance(o.state, dtUs);
+    }
+
+    //Новые
+    FrameVector<int> spawned(alloc);
+    for(auto& c : current) {
+        if(!Find(c.first)) spawned.push_back(c.first);
+    }
+    PutVarint(frame, spawned.size());
+    prevId = 0;
+    for(int id : spawned) {
+        PutVarint(frame, id - prevId);
+        prevId = id;
+        PutObject(frame, current[id]);
+    }
+    //id растут, так что новые объекты обычно уже по порядку в конце
+    if(!spawned.empty()) {
+        bool sorted = objects.empty() || objects.back().id < spawned.front();
+        ReserveFor(objects, spawned.size());
+        for(int id : spawned) {
+            objects.push_back(TrackedObject{id, current[id]});
+        }
+        if(!sorted) {
+            std::sort(objects.begin(), objects.end(),
+                      [](const TrackedObject& l, const TrackedObject& r) { return l.id < r.id; });
+        }
+    }
+
+    //Отклонения от предсказания. Положение поправляем, только если оно ушло больше чем на шаг квантования
+    FrameVector<unsigned char> changes(alloc);
+    int changedCount = 0;
+    prevId = 0;
+    for(auto& c : current) {
+        if(std::find(spawned.begin(), spawned.end(), c.first) != spawned.end()) continue;
+        Recording::ObjectState& pred = Find(c.first)->state;
+        const Recording::ObjectState& cur = c.second;
+        int64_t dx = RoundPos(cur.x) - RoundPos(pred.x);
+        int64_t dy = RoundPos(cur.y) - RoundPos(pred.y);
+        uint8_t flags = 0;
+        if(llabs(dx) > 1 || llabs(dy) > 1) flags |= changedPos;
+        if(cur.vx != pred.vx || cur.vy != pred.vy) flags |= changedVel;
+        if(cur.angle != pred.angle) flags |= changedAngle;
+        if(!flags) continue;
+
+        PutVarint(changes, c.first - prevId);
+        prevId = c.first;
+        changes.push_back(flags);
+        if(flags & changedPos) {
+            PutSigned(changes, dx);
+            PutSigned(changes, dy);
+            pred.x = ToFixed(RoundPos(cur.x));
+            pred.y = ToFixed(RoundPos(cur.y));
+        }
+        if(flags & changedVel) {
+            PutSigned(changes, int64_t(cur.vx) - pred.vx);
+            PutSigned(changes, int64_t(cur.vy) - pred.vy);
+            pred.vx = cur.vx;
+            pred.vy = cur.vy;
+        }
+        if(flags & changedAngle) {
+            PutSigned(changes, static_cast<int16_t>(cur.angle - pred.angle));
+            pred.angle = cur.angle;
+        }
+        changedCount++;
+    }
+    PutVarint(frame, changedCount);
+    frame.insert(frame.end(), changes.begin(), changes.end());
+}
+
+
+///RecordingReader///
+
+RecordingReader::~RecordingReader() {
+    Close();
+}
+
+bool RecordingReader::Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Recording::Header)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return false;
+    data = static_cast<const unsigned char*>(map);
+    size = st.st_size;
+
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != Recording::magic || header.version != Recording::version || header.keyframeInterval == 0) {
+        Close();
+        return false;
+    }
+
+    uint64_t keyframeCount = (uint64_t(header.frameCount) + header.keyframeInterval - 1) / header.keyframeInterval;
+    if(header.indexOffset != 0 && header.indexOffset <= size &&
+       (size - header.indexOffset) / sizeof(uint64_t) >= keyframeCount) {
+        index.resize(keyframeCount);
+        memcpy(index.data(), data + header.indexOffset, keyframeCount * sizeof(uint64_t));
+        dataEnd = header.indexOffset;
+    } else {
+        //Запись оборвалась: проходим по длинам кадров, последний неполный кадр отбрасываем
+        index.clear();
+        header.frameCount = 0;
+        size_t p = sizeof(Recording::Header);
+        while(p < size) {
+            size_t start = p;
+            uint64_t len;
+            if(!GetVarint(data, size, p, len) || len > size - p) break;
+            if(header.frameCount % header.keyframeInterval == 0) index.push_back(start);
+            p += len;
+            dataEnd = p;
+            header.frameCount++;
+        }
+    }
+    curFrame = -1;
+    return true;
+}
+
+void RecordingReader::Close() {
+    if(data) munmap(const_cast<unsigned char*>(data), size);
+    data = nullptr;
+    size = 0;
+    dataEnd = 0;
+    index.clear();
+    objects.clear();
+    curFrame = -1;
+}
+
+//Начало данных кадра, pos указывает на его длину
+bool RecordingReader::BeginFrame(size_t& end) {
+    uint64_t len;
+    if(!GetVarint(data, dataEnd, pos, len) || len > dataEnd - pos) return false;
+    end = pos + len;
+    return true;
+}
+
+bool RecordingReader::DecodeKeyframe() {
+    size_t end;
+    uint64_t dtUs, count;
+    int64_t s;
+    if(!BeginFrame(end) || !GetVarint(data, end, pos, dtUs) ||
+       !GetSigned(data, end, pos, s) || !GetVarint(data, end, pos, count)) return false;
+    score = s;
+    objects.clear();
+    int id = 0;
+    for(uint64_t i = 0; i < count; ++i) {
+        uint64_t gap;
+        Recording::ObjectState o;
+        if(!GetVarint(data, end, pos, gap) || !GetObject(data, end, pos, o)) return false;
+        id += gap;
+        objects[id] = o;
+    }
+    pos = end;
+    return true;
+}
+
+bool RecordingReader::DecodeDelta() {
+    size_t end;
+    uint64_t dtUs, count, gap;
+    int64_t s;
+    if(!BeginFrame(end) || !GetVarint(data, end, pos, dtUs) || !GetSigned(data, end, pos, s)) return false;
+    score += s;
+
+    if(!GetVarint(data, end, pos, count)) return false;
+    int id = 0;
+    for(uint64_t i = 0; i < count; ++i) {
+        if(!GetVarint(data, end, pos, gap)) return false;
+        id += gap;
+        objects.erase(id);
+    }
+
+    for(auto& o : objects) {
+        Recording::Advance(o.second, dtUs);
+    }
+
+    if(!GetVarint(data, end, pos, count)) return false;
+    id = 0;
+    for(uint64_t i = 0; i < count; ++i) {
+        Recording::ObjectState o;
+        if(!GetVarint(data, end, pos, gap) || !GetObject(data, end, pos, o)) return false;
+        id += gap;
+        objects[id] = o;
+    }
+
+    if(!GetVarint(data, end, pos, count)) return false;
+    id = 0;
+    for(uint64_t i = 0; i < count; ++i) {
+        if(!GetVarint(data, end, pos, gap) || pos >= end) return false;
+        id += gap;
+        uint8_t flags = data[pos++];
+        Recording::ObjectState& o = objects[id];
+        int64_t a, b;
+        if(flags & changedPos) {
+            if(!GetSigned(data, end, pos, a) || !GetSigned(data, end, pos, b)) return false;
+            o.x = ToFixed(RoundPos(o.x) + a);
+            o.y = ToFixed(RoundPos(o.y) + b);
+        }
+        if(flags & changedVel) {
+            if(!GetSigned(data, end, pos, a) || !GetSigned(data, end, pos, b)) return false;
+            o.vx += a;
+            o.vy += b;
+        }
+        if(flags & changedAngle) {
+            if(!GetSigned(data, end, pos, a)) return false;
+            o.angle += a;
+        }
+    }
+    pos = end;
+    return true;
+}
+
+bool RecordingReader::Seek(int frameNum, RecordedFrame& out) {
+    if(!data || frameNum < 0 || frameNum >= (int)header.frameCount) return false;
+    int key = frameNum / header.keyframeInterval;
+    //Вперед в пределах того же ключевого кадра продолжаем с текущего места
+    if(curFrame < 0 || curFrame > frameNum || curFrame / (int)header.keyframeInterval != key) {
+        pos = index[key];
+        curFrame = key * header.keyframeInterval;
+        if(!DecodeKeyframe()) {
+            curFrame = -1;
+            return false;
+        }
+    }
+    while(curFrame < frameNum) {
+        if(!DecodeDelta()) {
+            curFrame = -1;
+            return false;
+        }
+        curFrame++;
+    }
+
+    out.frame = curFrame;
+    out.score = score;
+    out.objects.clear();
+    for(auto& o : objects) {
+        RecordedObject r;
+        r.id = o.first;
+        r.type = static_cast<GOType>(o.second.type);
+        r.pos = Vec2(RoundPos(o.second.x), RoundPos(o.second.y)) / Constant::recordPosScale;
+        r.angle = o.second.angle * (2.f * M_PI / 65536.f);
+        out.objects.push_back(r);
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GameObject.h>
+
+class Game;
+
+//Запись партии: каждые keyframeInterval кадров полный ключевой кадр,
+//между ними - только отличия от предсказания.
+//Положения квантуются с шагом 1/Constant::recordPosScale, скорости - 1/Constant::recordVelScale в секунду,
+//углы - 65536 значений на оборот. Предсказание (движение с постоянной скоростью) считается
+//в целых числах, поэтому запись и чтение восстанавливают одно и то же состояние.
+//Объекты с неизменной скоростью (астероиды, пули) в кадрах почти не встречаются.
+//
+//Файл: Header, кадры подряд, в конце индекс смещений ключевых кадров (uint64 на каждый).
+//Поиск кадра - индекс[frame / keyframeInterval] и не больше keyframeInterval - 1 дельт
+namespace Recording {
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t keyframeInterval;
+        uint32_t frameCount;
+        uint64_t indexOffset;
+    };
+
+    static constexpr uint32_t magic = 0x43525341; //"ASRC"
+    static constexpr uint32_t version = 1;
+
+    //Состояние объекта так, как его видят запись и чтение
+    struct ObjectState {
+        uint8_t type;
+        int64_t x, y;   //положение, 1/65536 шага квантования
+        int32_t vx, vy; //скорость
+        uint16_t angle;
+    };
+
+    //Предсказание положения через dtUs микросекунд
+    void Advance(ObjectState& s, uint32_t dtUs);
+}
+
+//Record не обращается к диску и в установившемся режиме не выделяет память:
+//кадры кодируются в буфер, полный буфер пишет в файл отдельный поток.
+//Индекс и заголовок пишутся в Flush (при паузе) и Close
+class Recorder {
+    struct TrackedObject {
+        int id;
+        Recording::ObjectState state;
+    };
+
+    FILE* file = nullptr;
+    uint32_t keyframeInterval = 0;
+    uint32_t frameCount = 0;
+    //Конец закодированных кадров, включая еще не записанные
+    uint64_t writePos = 0;
+    int32_t lastScore = 0;
+    //Состояние, от которого считаются дельты, по возрастанию id
+    std::vector<TrackedObject> objects;
+    std::vector<uint64_t> keyframes;
+    std::vector<unsigned char> frame;
+    //Кадры, еще не отданные потоку записи
+    std::vector<unsigned char> pending;
+
+    //Поток записи. writing и stop - под mutex, filePos и indexWritten меняются
+    //только тем потоком, который сейчас пишет в файл
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<unsigned char> writing;
+    bool stop = false;
+    uint64_t filePos = 0;
+    bool indexWritten = false;
+
+    void WriteKeyframe(const Game& game, uint32_t dtUs);
+    void WriteDelta(const Game& game, uint32_t dtUs);
+    TrackedObject* Find(int id);
+
+    void RunWriter();
+    void WriteFrames(const std::vector<unsigned char>& data);
+    void WriteHeader(uint64_t indexOffset, uint32_t frames);
+
+public:
+    Recorder() {};
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+    ~Recorder();
+
+    bool Open(const std::string& path, int interval);
+    //Кодирует кадр после шага на dt секунд
+    void Record(const Game& game, float dt);
+    //Дописывает накопленные кадры, индекс и заголовок, чтобы файл можно было читать.
+    //Ждет поток записи, вызывается при паузе. Запись продолжается
+    void Flush();
+    void Close();
+    bool isOpen() const {return file != nullptr;};
+};
+
+//Объект кадра для просмотра
+struct RecordedObject {
+    int id;
+    GOType type;
+    Vec2 pos;
+    float angle;
+};
+
+struct RecordedFrame {
+    int frame = -1;
+    int score = 0;
+    std::vector<RecordedObject> objects;
+};
+
+//Чтение записи через mmap: файл не загружается целиком
+class RecordingReader {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    //Конец кадров (начало индекса)
+    size_t dataEnd = 0;
+    Recording::Header header;
+    std::vector<uint64_t> index;
+
+    //Состояние последнего декодированного кадра, от него можно идти вперед без возврата к ключевому
+    std::map<int, Recording::ObjectState> objects;
+    int32_t score = 0;
+    int curFrame = -1;
+    size_t pos = 0;
+
+    bool BeginFrame(size_t& end);
+    bool DecodeKeyframe();
+    bool DecodeDelta();
+
+public:
+    RecordingReader() {};
+    RecordingReader(const RecordingReader&) = delete;
+    RecordingReader& operator=(const RecordingReader&) = delete;
+    ~RecordingReader();
+
+    bool Open(const std::string& path);
+    void Close();
+    int getFrameCount() const {return data ? header.frameCount : 0;};
+    bool Seek(int frameNum, RecordedFrame& out);
+};
@@ -1,6 +1,15 @@
 #include <Renderer.h>
+#include <AllocTracker.h>
 
-#include <cassert>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+
+//Последним: подменяет вызовы OpenGL ниже
+#include <GLTrace.h>
 
 ///Model///
 
@@ -16,6 +25,11 @@ Model::Model(const std::vector<GLfloat>& _verts,
 //С++11 позволяет вызывать один конструктор из другого
 Model::Model(const std::vector<GLfloat>& _verts) : Model(_verts, std::move(DefaultIndices(_verts.size(), false))) {};
 
+Model::Model(const GLfloat* _verts, size_t count) : verts(_verts, _verts + count - count % 2),
+                                                   tverts(verts), indices(DefaultIndices(verts.size(), false)) {
+    CalcRadius();
+};
+
 float Model::CalcRadius() {
     float maxSqDist = 0.0f;
     for(int i = 0; i < verts.size(); i += 2) {
@@ -24,6 +38,7 @@ float Model::CalcRadius() {
     }
     sqrRadius = maxSqDist;
     radius = sqrt(maxSqDist);
+    return radius;
 }
 
 std::vector<GLubyte> Model::DefaultIndices(int sz, bool triangles) {
@@ -60,72 +75,389 @@ void Model::ApplyTransform(const Transform& t) {
         tverts[i] = verts[i] * a - verts[i + 1] * b + pos.x;
         tverts[i + 1] = verts[i] * c + verts[i + 1] * d + pos.y;
     }
+    center = pos;
+    changed = true;
 }
 
 
 ///Batch///
 
-Batch::Batch(bool isHudBatch)
-    : mMode(GL_LINES), mSetup([](){}), mHudBatch(isHudBatch),
-      mVerts(Constant::maxBatchSize), mIndices(Constant::maxBatchSize) {};
+Batch::Batch(Renderer& renderer, bool isHudBatch)
+    : mRenderer(renderer), mMode(GL_LINES), mSetup([](){}), mHudBatch(isHudBatch) {};
 
-void Batch::Draw() {
-    mSetup();
-    renderScale = mHudBatch ? Renderer::GetHUDScale() : Renderer::GetGameObjectScale();
-    Renderer::SetAlpha(mHudBatch ? Constant::buttonAlpha : 1.0f);
-    int totalVertSize = 0;
-    int totalIndSize = 0;
+void Batch::InitGL(GLint attrLoc) {
+    mVerts.resize(Constant::maxBatchSize);
+    mIndices.resize(Constant::maxBatchSize);
+    mAttrLoc = attrLoc;
+    glGenBuffers(1, &mVertBuf);
+    glGenBuffers(1, &mIndBuf);
+    //Старые буферы пропали вместе с контекстом
+    mDirty = true;
+}
+
+//Заодно убираем "висячие" weak_ptr
+bool Batch::IsChanged() {
+    bool changed = mDirty;
     for(auto i = mObjects.begin(); i != mObjects.end();) {
         if(i->expired()) {
-            //убираем "висячие" weak_ptr
             i = mObjects.erase(i);
+            changed = true;
         } else {
-            const Model& m = *i->lock().get();
+            changed = changed || i->lock()->isChanged();
             ++i;
+        }
+    }
+    return changed;
+}
 
-            if(m.getDraw()) {
-                const std::vector<GLfloat>& verts = m.getTransformed();
-                const std::vector<GLubyte>& indices = m.getIndices();
+void Batch::PackVertices(int& totalVertSize, int& totalIndSize) {
+    totalVertSize = 0;
+    totalIndSize = 0;
+    for(auto& i : mObjects) {
+        std::shared_ptr<Model> model = i.lock();
+        model->resetChanged();
+        const Model& m = *model;
 
-                for(int i = 0; i < verts.size(); i += 2) {
-                    mVerts[totalVertSize + i] = verts[i] * renderScale.x;
-                    mVerts[totalVertSize + i + 1] = verts[i + 1] * renderScale.y;
-                }
-                for(int i = 0; i < indices.size(); i += 1) {
-                    mIndices[totalIndSize + i] = indices[i] + totalVertSize/2;
-                }
-                totalVertSize += verts.size();
-                totalIndSize += indices.size();
+        Vec2 offset;
+        if(m.getDraw() && GetViewOffset(m, offset)) {
+            const std::vector<GLfloat>& verts = m.getTransformed();
+            const std::vector<GLubyte>& indices = m.getIndices();
+            //Емкость Batch не изменяется: модель, которая не помещается, пропускаем
+            if(totalVertSize + verts.size() > mVerts.size() || totalIndSize + indices.size() > mIndices.size()) continue;
 
-                //Емкость Batch не изменяется
-                assert(totalVertSize <= Constant::maxBatchSize);
-                assert(totalIndSize <= Constant::maxBatchSize);
+            for(int i = 0; i < verts.size(); i += 2) {
+                mVerts[totalVertSize + i] = (verts[i] + offset.x) * renderScale.x;
+                mVerts[totalVertSize + i + 1] = (verts[i + 1] + offset.y) * renderScale.y;
+            }
+            for(int i = 0; i < indices.size(); i += 1) {
+                mIndices[totalIndSize + i] = indices[i] + totalVertSize/2;
             }
+            totalVertSize += verts.size();
+            totalIndSize += indices.size();
         }
     }
-    //Обновляем index и vertex buffer каждый кадр
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndSize * sizeof(GLubyte), mIndices.data(), GL_STREAM_DRAW);
-    glBufferData(GL_ARRAY_BUFFER, totalVertSize * sizeof(GLfloat), mVerts.data(), GL_STREAM_DRAW);
-    glDrawElements(mMode, totalIndSize, GL_UNSIGNED_BYTE, (void*)0);
-    //buffer orphaning
-    /*glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndSize * sizeof(GLubyte), NULL, GL_STREAM_DRAW);
-    glBufferData(GL_ARRAY_BUFFER, totalVertSize * sizeof(GLfloat), NULL, GL_STREAM_DRAW);*/
+}
+
+void Batch::Pack() {
+    int totalVertSize, totalIndSize;
+    PackVertices(totalVertSize, totalIndSize);
+    mIndCount = totalIndSize;
+    mDirty = false;
+
+    //Интерфейс меняется редко, игровые объекты - каждый кадр
+    GLenum usage = mHudBatch ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndSize * sizeof(GLushort), mIndices.data(), usage);
+    glBufferData(GL_ARRAY_BUFFER, totalVertSize * sizeof(GLfloat), mVerts.data(), usage);
+}
+
+void Batch::UpdateScale() {
+    Vec2 scale = mHudBatch ? mRenderer.GetHUDScale() : mRenderer.GetGameObjectScale();
+    if(scale.x != renderScale.x || scale.y != renderScale.y) {
+        renderScale = scale;
+        mDirty = true;
+    }
+}
+
+//В большом мире модель рисуется относительно камеры, ближайшей к ней копией на торе.
+//Видимая область - [-1, 1] после renderScale, т.е. 1/renderScale в единицах мира
+bool Batch::GetViewOffset(const Model& m, Vec2& offset) const {
+    offset = Vec2();
+    if(!Constant::largeWorld || mHudBatch) return true;
+    Vec2 center = m.getCenter();
+    Vec2 d = Transform::WrapDelta(center - mRenderer.GetCamera());
+    if(fabs(d.x) - m.getRadius() > 1.0f / renderScale.x ||
+       fabs(d.y) - m.getRadius() > 1.0f / renderScale.y) return false;
+    offset = d - center;
+    return true;
+}
+
+float Batch::GetAlpha() const {
+    return mHudBatch ? Constant::buttonAlpha : 1.0f;
+}
+
+void Batch::Draw() {
+    mSetup();
+    if(mMode == GL_LINES) glLineWidth(mLineWidth);
+    UpdateScale();
+    mRenderer.SetAlpha(GetAlpha());
+
+    glBindBuffer(GL_ARRAY_BUFFER, mVertBuf);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndBuf);
+    glVertexAttribPointer(mAttrLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    //Если ничего не изменилось, рисуем то, что уже лежит в буферах
+    if(IsChanged()) Pack();
+    glDrawElements(mMode, mIndCount, GL_UNSIGNED_SHORT, (void*)0);
 }
 
 void Batch::Add(std::weak_ptr<Model> model) {
+    AllocTracker::Site site("Batch::Add");
     mObjects.push_back(std::move(model));
+    mDirty = true;
 }
 
 void Batch::Remove(std::weak_ptr<Model> model) {
     for(auto i = mObjects.begin(); i != mObjects.end(); ++i) {
         if(i->lock() == model.lock()) {
             mObjects.erase(i);
+            mDirty = true;
             break;
         }
     }
 }
 
 
+///UnifiedBatch///
+
+namespace {
+    //Масштаб компонент вершины: {x, y, x, y, полутолщина, alpha}
+    const float quantScale[] = {Constant::quantRange, Constant::quantRange,
+                                Constant::quantRange, Constant::quantRange,
+                                Constant::quantMaxHalfWidth, 1.0f};
+
+    //Нормализованный GL_SHORT: -32767..32767 соответствует -1..1
+    GLshort Quantize(float v, float scale) {
+        float q = v / scale;
+        q = q > 1.0f ? 1.0f : (q < -1.0f ? -1.0f : q);
+        return static_cast<GLshort>(lroundf(q * 32767.0f));
+    }
+}
+
+UnifiedBatch::UnifiedBatch()
+    : mVerts(Constant::maxUnifiedVerts * vertStride), mIndices(Constant::maxUnifiedIndices),
+      mStaticIndices(Constant::maxUnifiedIndices) {
+    if(Constant::compactVertices) mCompactVerts.resize(mVerts.size());
+};
+
+void UnifiedBatch::InitGL(GLuint program) {
+    glUseProgram(program);
+    mViewportLoc = glGetUniformLocation(program, "uViewport");
+    mScaleLoc = glGetUniformLocation(program, "uScale");
+    mFeatherLoc = glGetUniformLocation(program, "uFeather");
+    SetRenderScale(1.0f);
+
+    const size_t compSize = Constant::compactVertices ? sizeof(GLshort) : sizeof(GLfloat);
+    glGenBuffers(1, &mVertBuf);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertBuf);
+    glBufferData(GL_ARRAY_BUFFER, mVerts.size() * compSize, NULL, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &mIndBuf);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndBuf);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(GLushort), NULL, GL_DYNAMIC_DRAW);
+
+    const char* names[] = {"vPos", "vOther", "vWidth", "vAlpha"};
+    for(int i = 0; i < 4; ++i) mAttrLocs[i] = glGetAttribLocation(program, names[i]);
+    EnableAttribArrays(true);
+    BindVertexFormat();
+}
+
+void UnifiedBatch::EnableAttribArrays(bool enable) {
+    for(int i = 0; i < 4; ++i) {
+        if(enable) glEnableVertexAttribArray(mAttrLocs[i]);
+        else glDisableVertexAttribArray(mAttrLocs[i]);
+    }
+}
+
+//Формат вершин задается один раз, буферы переключает только растяжение
+//при динамическом разрешении (Renderer::DrawScaled)
+void UnifiedBatch::BindVertexFormat() {
+    const bool compact = Constant::compactVertices;
+    const size_t compSize = compact ? sizeof(GLshort) : sizeof(GLfloat);
+    const GLsizei stride = vertStride * compSize;
+    const int sizes[] = {2, 2, 1, 1};
+    int offset = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, mVertBuf);
+    for(int i = 0; i < 4; ++i) {
+        if(compact) {
+            glVertexAttribPointer(mAttrLocs[i], sizes[i], GL_SHORT, GL_TRUE, stride, (void*)(offset * compSize));
+        } else {
+            glVertexAttribPointer(mAttrLocs[i], sizes[i], GL_FLOAT, GL_FALSE, stride, (void*)(offset * compSize));
+        }
+        offset += sizes[i];
+    }
+}
+
+//Полутолщина считается в пикселях, поэтому шейдеру нужен размер экрана
+void UnifiedBatch::SetViewport(int width, int height) {
+    mViewport = Vec2(width / 2.0f, height / 2.0f);
+    glUniform2f(mViewportLoc, mViewport.x, mViewport.y);
+}
+
+//В уменьшенной цели пиксель крупнее, толщина в пикселях уменьшается во столько же раз
+void UnifiedBatch::SetRenderScale(float scale) {
+    glUniform2f(mViewportLoc, mViewport.x * scale, mViewport.y * scale);
+    if(Constant::compactVertices) {
+        glUniform3f(mScaleLoc, Constant::quantRange, Constant::quantMaxHalfWidth * scale, 1.0f);
+    } else {
+        glUniform3f(mScaleLoc, 1.0f, scale, 1.0f);
+    }
+}
+
+void UnifiedBatch::SetFeather(float feather) {
+    if(mFeatherLoc >= 0) glUniform1f(mFeatherLoc, feather);
+}
+
+//Диапазоны в элементах массивов mVerts и mIndices
+void UnifiedBatch::Upload(int vertFrom, int vertTo, int indFrom, int indTo) {
+    if(Constant::compactVertices) {
+        for(int i = vertFrom; i < vertTo; ++i) {
+            mCompactVerts[i] = Quantize(mVerts[i], quantScale[i % vertStride]);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, vertFrom * sizeof(GLshort),
+                        (vertTo - vertFrom) * sizeof(GLshort), &mCompactVerts[vertFrom]);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, vertFrom * sizeof(GLfloat),
+                        (vertTo - vertFrom) * sizeof(GLfloat), &mVerts[vertFrom]);
+    }
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indFrom * sizeof(GLushort),
+                    (indTo - indFrom) * sizeof(GLushort), &mIndices[indFrom]);
+
+    if(Constant::logRenderStats) {
+        size_t compSize = Constant::compactVertices ? sizeof(GLshort) : sizeof(GLfloat);
+        size_t indBytes = (indTo - indFrom) * sizeof(GLushort);
+        mUploadedBytes += (vertTo - vertFrom) * compSize + indBytes;
+        mFloatBytes += (vertTo - vertFrom) * sizeof(GLfloat) + indBytes;
+        if(Constant::compactVertices) {
+            //Сравниваем с float: погрешность положения вершины в пикселях
+            for(int i = vertFrom; i < vertTo; i += vertStride) {
+                for(int c = 0; c < 2; ++c) {
+                    float restored = mCompactVerts[i + c] / 32767.0f * Constant::quantRange;
+                    float error = fabs(restored - mVerts[i + c]) * (c ? mViewport.y : mViewport.x);
+                    if(error > mMaxQuantError) mMaxQuantError = error;
+                }
+            }
+        }
+    }
+}
+
+void UnifiedBatch::LogStats() {
+    if(++mStatsFrames < Constant::renderStatsFrames) return;
+    LOGI("Render: %.1f bytes/frame uploaded, %.1f bytes/frame as float, max quantization error %.4f px",
+         (float) mUploadedBytes / mStatsFrames, (float) mFloatBytes / mStatsFrames, mMaxQuantError);
+    mStatsFrames = 0;
+    mUploadedBytes = 0;
+    mFloatBytes = 0;
+    mMaxQuantError = 0.0f;
+}
+
+void UnifiedBatch::Append(Batch& batch, int& vertSize, int& indSize, int indCapacity) {
+    batch.UpdateScale();
+    const float alpha = batch.GetAlpha();
+    const float halfWidth = batch.mMode == GL_LINES ? batch.mLineWidth / 2.0f : 0.0f;
+    const Vec2 scale = batch.renderScale;
+
+    auto putVert = [&](Vec2 p, Vec2 other, float width) {
+        GLfloat* v = &mVerts[vertSize];
+        v[0] = p.x;
+        v[1] = p.y;
+        v[2] = other.x;
+        v[3] = other.y;
+        v[4] = width;
+        v[5] = alpha;
+        vertSize += vertStride;
+    };
+
+    for(auto& i : batch.mObjects) {
+        std::shared_ptr<Model> model = i.lock();
+        model->resetChanged();
+        Vec2 offset;
+        if(!model->getDraw() || !batch.GetViewOffset(*model, offset)) continue;
+
+        const std::vector<GLfloat>& verts = model->getTransformed();
+        const std::vector<GLubyte>& indices = model->getIndices();
+        const int indCount = indices.size();
+        //Емкость не изменяется: модель, которая не помещается целиком, пропускаем
+        //(для линий - оценка сверху, без прореживания)
+        const int needVerts = batch.mMode == GL_LINES ? indCount / 2 * 4 * vertStride : verts.size() / 2 * vertStride;
+        const int needInds = batch.mMode == GL_LINES ? indCount / 2 * 6 : indCount;
+        if(vertSize + needVerts > static_cast<int>(mVerts.size()) || indSize + needInds > indCapacity) continue;
+
+        if(batch.mMode == GL_LINES) {
+            const bool decimate = batch.mDecimate && model->isOutline();
+            //Каждый отрезок - четыре вершины и два треугольника
+            for(int j = 0; j + 1 < indCount; j += 2) {
+                const int first = j;
+                int last = j + 1;
+                //Соседние отрезки контура (a, b), (b, c) заменяются на (a, c)
+                if(decimate && j + 3 < indCount && indices[j + 1] == indices[j + 2]) {
+                    last = j + 3;
+                    j += 2;
+                }
+                Vec2 p0 = Vec2(first, verts, indices) + offset;
+                Vec2 p1 = Vec2(last, verts, indices) + offset;
+                p0 = Vec2(p0.x * scale.x, p0.y * scale.y);
+                p1 = Vec2(p1.x * scale.x, p1.y * scale.y);
+                GLushort base = vertSize / vertStride;
+                putVert(p0, p1, halfWidth);
+                putVert(p0, p1, -halfWidth);
+                //У второго конца направление отрезка обратное, поэтому знаки тоже
+                putVert(p1, p0, -halfWidth);
+                putVert(p1, p0, halfWidth);
+                const GLushort quad[] = {0, 1, 2, 2, 1, 3};
+                for(GLushort q : quad) {
+                    mIndices[indSize++] = base + q;
+                }
+            }
+        } else {
+            GLushort base = vertSize / vertStride;
+            for(size_t j = 0; j < verts.size(); j += 2) {
+                Vec2 p((verts[j] + offset.x) * scale.x, (verts[j + 1] + offset.y) * scale.y);
+                putVert(p, p, 0.0f);
+            }
+            for(GLubyte ind : indices) {
+                mIndices[indSize++] = base + ind;
+            }
+        }
+    }
+    batch.mDirty = false;
+}
+
+void UnifiedBatch::Update(const std::vector<Batch*>& staticBatches, Batch& dynamicBatch) {
+    int vertSize = mStaticVertSize;
+    int indSize = 0;
+
+    bool staticChanged = false;
+    for(Batch* b : staticBatches) {
+        //IsChanged без сокращенного вычисления, чтобы все батчи убрали "висячие" модели
+        if(b->IsChanged()) staticChanged = true;
+        b->UpdateScale();
+        if(b->mDirty) staticChanged = true;
+    }
+    if(staticChanged) {
+        vertSize = 0;
+        for(Batch* b : staticBatches) {
+            Append(*b, vertSize, indSize, Constant::maxUnifiedIndices);
+        }
+        std::copy(mIndices.begin(), mIndices.begin() + indSize, mStaticIndices.begin());
+        mStaticVertSize = vertSize;
+        mStaticIndSize = indSize;
+        indSize = 0;
+        Upload(0, vertSize, 0, 0);
+    }
+
+    //Вершины игровых объектов дописываются после интерфейса, индексы - в начало,
+    //за ними индексы интерфейса. Загружается всё, кроме вершин интерфейса
+    dynamicBatch.IsChanged();
+    Append(dynamicBatch, vertSize, indSize, Constant::maxUnifiedIndices - mStaticIndSize);
+    mDynamicIndSize = indSize;
+    std::copy(mStaticIndices.begin(), mStaticIndices.begin() + mStaticIndSize, mIndices.begin() + indSize);
+    indSize += mStaticIndSize;
+    Upload(mStaticVertSize, vertSize, 0, indSize);
+    if(Constant::logRenderStats) LogStats();
+}
+
+void UnifiedBatch::DrawStatic() {
+    glDrawElements(GL_TRIANGLES, mStaticIndSize, GL_UNSIGNED_SHORT, (void*)(mDynamicIndSize * sizeof(GLushort)));
+}
+
+void UnifiedBatch::DrawDynamic() {
+    glDrawElements(GL_TRIANGLES, mDynamicIndSize, GL_UNSIGNED_SHORT, (void*)0);
+}
+
+void UnifiedBatch::Draw(const std::vector<Batch*>& staticBatches, Batch& dynamicBatch) {
+    Update(staticBatches, dynamicBatch);
+    glDrawElements(GL_TRIANGLES, mDynamicIndSize + mStaticIndSize, GL_UNSIGNED_SHORT, (void*)0);
+}
+
+
 ///Игровые модели///
 
 std::shared_ptr<Model> Model::CreateTriangleBtn() {
@@ -195,6 +527,7 @@ std::shared_ptr<Model> Model::CreateRestartBtn() {
 }
 
 std::shared_ptr<Model> Model::CreateShip() {
+    AllocTracker::Site site("Model::Create");
     return std::shared_ptr<Model> (new Model({   0.0f, 0.065f,
                                                 0.05f, -0.065f,
                                                0.017f, -0.03f,
@@ -203,13 +536,15 @@ std::shared_ptr<Model> Model::CreateShip() {
 }
 
 std::shared_ptr<Model> Model::CreateShipEngine() {
+    AllocTracker::Site site("Model::Create");
     return std::shared_ptr<Model> (new Model({   0.0f, -0.05f,
                                                0.017f, -0.03f,
                                               -0.017f, -0.03f},
                                              {0, 1, 0, 2}));
 }
 
-std::shared_ptr<Model> Model::CreateAsteroid() {
+std::shared_ptr<Model> Model::CreateAsteroid(Random& random) {
+    AllocTracker::Site site("Model::Create");
     const int vertCount = Constant::asteroidVertCount;
     std::bernoulli_distribution coin(Constant::asteroidRadiusDistribution);
     std::uniform_real_distribution<float> shift(-Constant::asteroidAngleVariance, Constant::asteroidAngleVariance);
@@ -218,23 +553,29 @@ std::shared_ptr<Model> Model::CreateAsteroid() {
     //Проходим по кругу, выбираем угол с некоторым смещением,
     //размещаем вершину либо на большом, либо на малом радиусе
     std::vector<float> verts(vertCount * 2);
+    float angles[vertCount], radii[vertCount], s[vertCount], c[vertCount];
     for(int i = 0; i < vertCount; ++i) {
-        float angle = 2.0 * M_PI * i / vertCount + shift(Random::generator);
-        float radius = coin(Random::generator) ? Constant::asteroidBigRadius : Constant::asteroidSmallRadius;
-        verts[i*2] = radius * cos(angle);
-        verts[i*2 + 1] = radius * sin(angle);
+        angles[i] = 2.0 * M_PI * i / vertCount + shift(random.generator);
+        radii[i] = coin(random.generator) ? Constant::asteroidBigRadius : Constant::asteroidSmallRadius;
+    }
+    FastMath::SinCos(angles, s, c, vertCount);
+    for(int i = 0; i < vertCount; ++i) {
+        verts[i*2] = radii[i] * c[i];
+        verts[i*2 + 1] = radii[i] * s[i];
     }
 
     return std::make_shared<Model>(verts);
 }
 
 std::shared_ptr<Model> Model::CreateBullet() {
+    AllocTracker::Site site("Model::Create");
     return std::shared_ptr<Model> (new Model({ 0.0f, -0.02f,
                                                0.0f, 0.02f  },
                                                {0, 1}));
 }
 
 std::shared_ptr<Model> Model::CreateUFO() {
+    AllocTracker::Site site("Model::Create");
     return std::shared_ptr<Model> (new Model({-0.125f, 0.0f,
                                                -0.05f, 0.05f,
                                               -0.025f, 0.1f,
@@ -246,35 +587,9 @@ std::shared_ptr<Model> Model::CreateUFO() {
                                                {0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 0, 0, 5, 1, 4} ));
 }
 
-std::shared_ptr<Model> Model::CreateExplosion() {
-    const int vertCount = Constant::explosionVertCount;
-    std::uniform_real_distribution<float> disp(Constant::explosionSpikeLen / 3, Constant::explosionSpikeLen);
-    std::uniform_real_distribution<float> shift(-Constant::asteroidAngleVariance, Constant::asteroidAngleVariance);
-
-    //Аналогично астероидам (см. CreateAsteroid)
-    std::vector<float> verts(vertCount * 4);
-    for(int i = 0; i < vertCount; ++i) {
-        float angle = 2.0 * M_PI * i / vertCount + shift(Random::generator);
-        float dist = disp(Random::generator);
-        verts[i*4] = dist * cos(angle);
-        verts[i*4 + 1] = dist * sin(angle);
-        verts[i*4 + 2] = (dist + Constant::explosionSpikeLen) * cos(angle);
-        verts[i*4 + 3] = (dist + Constant::explosionSpikeLen) * sin(angle);
-    }
-
-    return std::make_shared<Model>(verts);
-}
-
 
 ///Renderer///
 
-GLint Renderer::uniLoc;
-Vec2 Renderer::goScale;
-Vec2 Renderer::hudScale;
-std::unique_ptr<Batch> Renderer::goBatch;
-std::unique_ptr<Batch> Renderer::hudBatch;
-std::unique_ptr<Batch> Renderer::controlsBatch;
-
 //Максимально простые шейдеры
 const std::string Renderer::vShaderStr {"attribute vec4 vPos;       \n"
                                         "void main()                \n"
@@ -289,27 +604,170 @@ const std::string Renderer::fShaderStr {"precision lowp float;
                                         " gl_FragColor = vec4(1.0, 1.0, 1.0, fAlpha);\n"
                                         "}                                           \n"};
 
+//Смещаем вершину перпендикулярно отрезку на vWidth пикселей
+const std::string Renderer::vUnifiedShaderStr {"attribute vec2 vPos;                                    \n"
+                                               "attribute vec2 vOther;                                  \n"
+                                               "attribute float vWidth;                                 \n"
+                                               "attribute float vAlpha;                                 \n"
+                                               "uniform vec2 uViewport;                                 \n"
+                                               "uniform vec3 uScale;                                    \n"
+                                               "varying float fAlpha;                                   \n"
+                                               "void main()                                             \n"
+                                               "{                                                       \n"
+                                               " vec2 pos = vPos * uScale.x;                            \n"
+                                               " vec2 dir = (vOther * uScale.x - pos) * uViewport;      \n"
+                                               " vec2 norm = vec2(0.0);                                 \n"
+                                               " if(dot(dir, dir) > 0.0) norm = normalize(vec2(-dir.y, dir.x));\n"
+                                               " gl_Position = vec4(pos + norm * vWidth * uScale.y / uViewport, 0.0, 1.0);\n"
+                                               " fAlpha = vAlpha * uScale.z;                            \n"
+                                               "}                                                       \n"};
+
+const std::string Renderer::fUnifiedShaderStr {"precision lowp float;                       \n"
+                                               "varying float fAlpha;                       \n"
+                                               "void main()                                 \n"
+                                               "{                                           \n"
+                                               " gl_FragColor = vec4(1.0, 1.0, 1.0, fAlpha);\n"
+                                               "}                                           \n"};
+
+//То же, но отрезок расширен на uFeather (пиксель) с каждой стороны, а фрагментный шейдер
+//умножает alpha на долю пикселя, покрытую отрезком
+//fEdge.x - расстояние от оси отрезка в пикселях, fEdge.y - полутолщина (у треугольников - заведомо больше)
+//Знак расстояния берется относительно одного направления отрезка для обоих концов,
+//иначе у второго конца (vOther и vPos поменяны местами) он был бы обратным
+const std::string Renderer::vSmoothShaderStr {"attribute vec2 vPos;                                    \n"
+                                              "attribute vec2 vOther;                                  \n"
+                                              "attribute float vWidth;                                 \n"
+                                              "attribute float vAlpha;                                 \n"
+                                              "uniform vec2 uViewport;                                 \n"
+                                              "uniform vec3 uScale;                                    \n"
+                                              "uniform mediump float uFeather;                         \n"
+                                              "varying float fAlpha;                                   \n"
+                                              "varying vec2 fEdge;                                     \n"
+                                              "void main()                                             \n"
+                                              "{                                                       \n"
+                                              " vec2 pos = vPos * uScale.x;                            \n"
+                                              " vec2 dir = (vOther * uScale.x - pos) * uViewport;      \n"
+                                              " vec2 norm = vec2(0.0);                                 \n"
+                                              " float hw = abs(vWidth) * uScale.y;                     \n"
+                                              " float side = vWidth < 0.0 ? -1.0 : 1.0;                \n"
+                                              " fEdge = vec2(0.0, 1000.0);                             \n"
+                                              " if(dot(dir, dir) > 0.0) {                              \n"
+                                              "  norm = normalize(vec2(-dir.y, dir.x)) * side * (hw + uFeather);\n"
+                                              "  float o = dir.x > 0.0 || (dir.x == 0.0 && dir.y > 0.0) ? 1.0 : -1.0;\n"
+                                              "  fEdge = vec2(side * o * (hw + uFeather), hw);         \n"
+                                              " }                                                      \n"
+                                              " gl_Position = vec4(pos + norm / uViewport, 0.0, 1.0);  \n"
+                                              " fAlpha = vAlpha * uScale.z;                            \n"
+                                              "}                                                       \n"};
+
+//uFeather = 0 - без сглаживания: четырехугольник не расширяется, покрытие почти везде 1
+const std::string Renderer::fSmoothShaderStr {"precision mediump float;                    \n"
+                                              "uniform float uFeather;                     \n"
+                                              "varying float fAlpha;                       \n"
+                                              "varying vec2 fEdge;                         \n"
+                                              "void main()                                 \n"
+                                              "{                                           \n"
+                                              " float cover = clamp((fEdge.y - abs(fEdge.x)) / max(uFeather, 0.01) + 0.5, 0.0, 1.0);\n"
+                                              " gl_FragColor = vec4(1.0, 1.0, 1.0, fAlpha * cover);\n"
+                                              "}                                           \n"};
+
+//Растяжение уменьшенной цели отрисовки на экран. Координаты текстуры ограничены
+//последним отрисованным текселем, чтобы фильтрация не захватывала область за ним
+const std::string Renderer::vBlitShaderStr {"attribute vec2 vPos;                    \n"
+                                            "uniform vec2 uTexScale;                 \n"
+                                            "varying vec2 fTex;                      \n"
+                                            "void main()                             \n"
+                                            "{                                       \n"
+                                            " fTex = (vPos * 0.5 + 0.5) * uTexScale; \n"
+                                            " gl_Position = vec4(vPos, 0.0, 1.0);    \n"
+                                            "}                                       \n"};
+
+const std::string Renderer::fBlitShaderStr {"precision mediump float;                          \n"
+                                            "uniform sampler2D uTex;                           \n"
+                                            "uniform vec2 uTexMax;                             \n"
+                                            "varying vec2 fTex;                                \n"
+                                            "void main()                                       \n"
+                                            "{                                                 \n"
+                                            " gl_FragColor = texture2D(uTex, min(fTex, uTexMax));\n"
+                                            "}                                                 \n"};
+
+GLuint Renderer::CreateProgram(const std::string& vShader, const std::string& fShader, const std::string& name) {
+    //Берем программу из кэша, если не вышло - компилируем
+    GLuint program = glCreateProgram();
+    //При записи потока команд кэш не используется, чтобы в поток попали исходники шейдеров
+    std::string path = programCacheDir.empty() || Constant::glCapture ? "" : programCacheDir + "/" + name + ".bin";
+    size_t key = ProgramCacheKey(vShader, fShader);
+    if(LoadProgramBinary(program, path, key)) {
+        StartupTrace::Mark("program loaded from cache");
+    } else {
+        glAttachShader(program, Renderer::LoadShader(GL_VERTEX_SHADER, vShader));
+        glAttachShader(program, Renderer::LoadShader(GL_FRAGMENT_SHADER, fShader));
+        glLinkProgram(program);
+        SaveProgramBinary(program, path, key);
+        StartupTrace::Mark("program compiled from source");
+    }
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if(linked != GL_TRUE) {
+        LOGW("Program %s failed to link", name.c_str());
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
 void Renderer::InitGLContext() {
-    //Компилируем шейдерную программу, запоминаем расположение переменных
-    GLuint programObject = glCreateProgram();
-    glAttachShader(programObject, Renderer::LoadShader(GL_VERTEX_SHADER, vShaderStr));
-    glAttachShader(programObject, Renderer::LoadShader(GL_FRAGMENT_SHADER, fShaderStr));
-    glLinkProgram(programObject);
-    glUseProgram(programObject);
+    GLTrace::OnContextCreated();
+    //Если общая программа не собралась, остаемся на отдельных батчах
+    if(!Constant::unifiedRendering) {
+        unifiedProgram = 0;
+    } else if(Constant::smoothLines) {
+        unifiedProgram = CreateProgram(vSmoothShaderStr, fSmoothShaderStr, "smooth");
+    } else {
+        unifiedProgram = CreateProgram(vUnifiedShaderStr, fUnifiedShaderStr, "unified");
+    }
 
-    GLint attrLoc = glGetAttribLocation(programObject, "vPos");
-    glEnableVertexAttribArray(attrLoc);
-    uniLoc = glGetUniformLocation(programObject, "fAlpha");
+    if(unifiedProgram) {
+        if(!unifiedBatch) unifiedBatch = std::unique_ptr<UnifiedBatch> (new UnifiedBatch());
+        unifiedBatch->InitGL(unifiedProgram);
+        unifiedBatch->SetFeather(lineSmoothing ? 1.0f : 0.0f);
+        //Батчи используются только как списки моделей, но должны знать о новом контексте
+        goBatch->mDirty = true;
+        hudBatch->mDirty = true;
+        controlsBatch->mDirty = true;
+    } else {
+        //Запоминаем расположение переменных
+        batchProgram = CreateProgram(vShaderStr, fShaderStr, "batch");
+        glUseProgram(batchProgram);
 
-    //Для отрисовки используем буферы и индексацию
-    GLuint vb, ib;
+        GLint attrLoc = glGetAttribLocation(batchProgram, "vPos");
+        glEnableVertexAttribArray(attrLoc);
+        uniLoc = glGetUniformLocation(batchProgram, "fAlpha");
 
-    glGenBuffers(1, &vb);
-    glBindBuffer(GL_ARRAY_BUFFER, vb);
-    glVertexAttribPointer(attrLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        //Для отрисовки используем буферы и индексацию, у каждого батча свои
+        goBatch->InitGL(attrLoc);
+        hudBatch->InitGL(attrLoc);
+        controlsBatch->InitGL(attrLoc);
+    }
 
-    glGenBuffers(1, &ib);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib);
+    //Цель отрисовки создается под размер экрана в OnResolutionChange
+    sceneFramebuffer = 0;
+    sceneTexture = 0;
+    blitProgram = unifiedProgram && Constant::dynamicResolution ?
+        CreateProgram(vBlitShaderStr, fBlitShaderStr, "blit") : 0;
+    if(blitProgram) {
+        glUseProgram(blitProgram);
+        blitPosLoc = glGetAttribLocation(blitProgram, "vPos");
+        blitTexScaleLoc = glGetUniformLocation(blitProgram, "uTexScale");
+        blitTexMaxLoc = glGetUniformLocation(blitProgram, "uTexMax");
+        const GLfloat quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+        glGenBuffers(1, &blitBuf);
+        glBindBuffer(GL_ARRAY_BUFFER, blitBuf);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glUseProgram(unifiedProgram);
+        unifiedBatch->BindVertexFormat();
+    }
 
     glDepthMask(GL_FALSE);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -319,26 +777,108 @@ void Renderer::InitGLContext() {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
+//Если программа со сглаживанием не соберется, линии останутся без сглаживания:
+//конфигурация EGL выбирается раньше, чем создается контекст
+int Renderer::getMultiSamples() {
+    return Constant::unifiedRendering && Constant::smoothLines ? Constant::smoothLineSamples : Constant::msaaSamples;
+}
+
 void Renderer::SetAlpha(float a) {
     glUniform1f(uniLoc, a);
 }
 
-void Renderer::InitInternals() {
-    goBatch = std::unique_ptr<Batch> (new Batch(false));
-    goBatch->setSetupFunction([](){ glLineWidth(Constant::gameObjectLineWidth); });
+Renderer::Renderer() {
+    goBatch = std::unique_ptr<Batch> (new Batch(*this, false));
+    goBatch->setLineWidth(Constant::gameObjectLineWidth);
 
-    hudBatch = std::unique_ptr<Batch> (new Batch(true));
-    hudBatch->setSetupFunction([](){ glLineWidth(Constant::interfaceLineWidth); });
+    hudBatch = std::unique_ptr<Batch> (new Batch(*this, true));
+    hudBatch->setLineWidth(Constant::interfaceLineWidth);
 
-    controlsBatch = std::unique_ptr<Batch> (new Batch(true));
+    controlsBatch = std::unique_ptr<Batch> (new Batch(*this, true));
     controlsBatch->setDrawMode(GL_TRIANGLES);
 }
 
 void Renderer::Draw() {
+    if(sceneFramebuffer && dynRes.getScale() < 1.0f) {
+        DrawScaled();
+    } else if(unifiedProgram) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        unifiedBatch->Draw({hudBatch.get(), controlsBatch.get()}, *goBatch);
+    } else {
+        glClear(GL_COLOR_BUFFER_BIT);
+        goBatch->Draw();
+        hudBatch->Draw();
+        controlsBatch->Draw();
+    }
+    GLTrace::EndFrame();
+}
+
+//Игровые объекты - в уменьшенную цель, растяжение на экран, поверх - интерфейс
+void Renderer::DrawScaled() {
+    const float scale = dynRes.getScale();
+    const int w = std::max(1, static_cast<int>(screenWidth * scale + 0.5f));
+    const int h = std::max(1, static_cast<int>(screenHeight * scale + 0.5f));
+    unifiedBatch->Update({hudBatch.get(), controlsBatch.get()}, *goBatch);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glViewport(0, 0, w, h);
     glClear(GL_COLOR_BUFFER_BIT);
-    goBatch->Draw();
-    hudBatch->Draw();
-    controlsBatch->Draw();
+    unifiedBatch->SetRenderScale(scale);
+    unifiedBatch->DrawDynamic();
+
+    //Растяжение непрозрачное и закрывает весь экран, очищать его не нужно
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screenWidth, screenHeight);
+    glUseProgram(blitProgram);
+    unifiedBatch->EnableAttribArrays(false);
+    glEnableVertexAttribArray(blitPosLoc);
+    glUniform2f(blitTexScaleLoc, (float) w / screenWidth, (float) h / screenHeight);
+    glUniform2f(blitTexMaxLoc, (w - 0.5f) / screenWidth, (h - 0.5f) / screenHeight);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glBindBuffer(GL_ARRAY_BUFFER, blitBuf);
+    glVertexAttribPointer(blitPosLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glDisable(GL_BLEND);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEnable(GL_BLEND);
+    glDisableVertexAttribArray(blitPosLoc);
+
+    glUseProgram(unifiedProgram);
+    unifiedBatch->EnableAttribArrays(true);
+    unifiedBatch->BindVertexFormat();
+    unifiedBatch->SetRenderScale(1.0f);
+    unifiedBatch->DrawStatic();
+}
+
+void Renderer::OnFrameTime(float dt, float targetFrameTime, bool canRaise) {
+    if(!sceneFramebuffer) return;
+    if(dynRes.OnFrame(dt, targetFrameTime, canRaise)) LOGI("Render scale %.3f", dynRes.getScale());
+}
+
+void Renderer::SetLineSmoothing(bool smooth) {
+    lineSmoothing = smooth;
+    if(unifiedProgram) unifiedBatch->SetFeather(smooth ? 1.0f : 0.0f);
+}
+
+//Текстура размером с экран, при уменьшении используется ее часть
+void Renderer::InitSceneTarget() {
+    if(!sceneTexture) glGenTextures(1, &sceneTexture);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, screenWidth, screenHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    if(!sceneFramebuffer) glGenFramebuffers(1, &sceneFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneTexture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    //Без цели отрисовки остаемся в полном разрешении
+    if(status != GL_FRAMEBUFFER_COMPLETE) {
+        LOGW("Scene framebuffer incomplete (0x%04x), dynamic resolution disabled", status);
+        sceneFramebuffer = 0;
+    }
 }
 
 void Renderer::OnResolutionChange(int width, int height) {
@@ -354,6 +894,10 @@ void Renderer::OnResolutionChange(int width, int height) {
     hudScale.y = 1.0f;
 
     glViewport(0, 0, width, height);
+    if(unifiedProgram) unifiedBatch->SetViewport(width, height);
+    screenWidth = width;
+    screenHeight = height;
+    if(blitProgram) InitSceneTarget();
 }
 
 GLuint Renderer::LoadShader(GLenum type, const std::string& shaderSrc) {
@@ -362,4 +906,127 @@ GLuint Renderer::LoadShader(GLenum type, const std::string& shaderSrc) {
 	glShaderSource(shader, 1, &p, NULL);
 	glCompileShader(shader);
 	return shader;
-}
\ No newline at end of file
+}
+
+
+
+///DynamicResolution///
+
+bool DynamicResolution::OnFrame(float frameTime, float targetFrameTime, bool canRaise) {
+    if(frameTime <= 0.0f || frameTime > Constant::dynResMaxFrameTime) return false;
+    if(avgFrameTime == 0.0f) avgFrameTime = frameTime;
+    avgFrameTime += (frameTime - avgFrameTime) * 0.1f;
+    if(cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    const float target = targetFrameTime;
+    if(avgFrameTime > target * Constant::dynResSlowRatio) {
+        fastFrames = 0;
+        if(scale <= Constant::dynResMinScale) return false;
+        //Проба не удалась: в этом разрешении кадр не успевает
+        if(probing) upWait = std::min(upWait * 2, Constant::dynResMaxUpFrames);
+        probing = false;
+        scale = std::max(Constant::dynResMinScale, scale - Constant::dynResStep);
+        cooldown = Constant::dynResCooldownFrames;
+        return true;
+    }
+
+    fastFrames = avgFrameTime < target * Constant::dynResFastRatio ? fastFrames + 1 : 0;
+    if(probing && fastFrames >= Constant::dynResUpFrames) {
+        probing = false;
+        upWait = Constant::dynResUpFrames;
+    }
+    if(canRaise && scale < 1.0f && fastFrames >= upWait) {
+        scale = std::min(1.0f, scale + Constant::dynResStep);
+        probing = true;
+        fastFrames = 0;
+        cooldown = Constant::dynResCooldownFrames;
+        return true;
+    }
+    return false;
+}
+
+
+///Кэш шейдерной программы///
+
+std::string Renderer::programCacheDir;
+
+namespace {
+    //Заголовок файла кэша
+    struct ProgramCacheHeader {
+        size_t key;
+        GLenum format;
+        GLint length;
+    };
+
+    PFNGLGETPROGRAMBINARYOESPROC getProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYOESPROC programBinary = nullptr;
+
+    //Расширение проверяется при каждой инициализации контекста
+    bool ProgramBinarySupported() {
+        const char* ext = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if(!ext || !strstr(ext, "GL_OES_get_program_binary")) return false;
+        getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+        programBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+        return getProgramBinary && programBinary;
+    }
+}
+
+void Renderer::SetCacheDir(const std::string& dir) {
+    programCacheDir = dir;
+}
+
+//Бинарник годится только для тех же исходников и того же драйвера
+size_t Renderer::ProgramCacheKey(const std::string& vShader, const std::string& fShader) {
+    std::string key = vShader + fShader;
+    const GLubyte* strs[] = {glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION)};
+    for(auto str : strs) {
+        if(str) key += reinterpret_cast<const char*>(str);
+    }
+    return std::hash<std::string>()(key);
+}
+
+bool Renderer::LoadProgramBinary(GLuint program, const std::string& path, size_t key) {
+    if(path.empty() || !ProgramBinarySupported()) return false;
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+
+    ProgramCacheHeader header;
+    std::vector<char> data;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && header.key == key && header.length > 0;
+    if(ok) {
+        data.resize(header.length);
+        ok = fread(data.data(), 1, data.size(), f) == data.size();
+    }
+    fclose(f);
+    if(!ok) return false;
+
+    //Драйвер вправе отвергнуть бинарник, тогда вернемся к исходникам
+    programBinary(program, header.format, data.data(), header.length);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+void Renderer::SaveProgramBinary(GLuint program, const std::string& path, size_t key) {
+    if(path.empty() || !ProgramBinarySupported()) return;
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if(linked != GL_TRUE) return;
+
+    ProgramCacheHeader header;
+    header.key = key;
+    header.length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &header.length);
+    if(header.length <= 0) return;
+    std::vector<char> data(header.length);
+    getProgramBinary(program, header.length, &header.length, &header.format, data.data());
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return;
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(data.data(), 1, header.length, f);
+    fclose(f);
+}
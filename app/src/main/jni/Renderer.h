@@ -16,10 +16,16 @@ protected:
     std::vector<GLubyte> indices; //Индексы
 
     bool draw = true;
+    //Замкнутый контур, который можно рисовать через вершину (см. Batch::setDecimation)
+    bool outline = false;
+    //Изменилась ли модель с момента последней упаковки в Batch
+    bool changed = true;
     float radius = 0.0f;
     float sqrRadius = 0.0f;
+    Vec2 center; //Позиция из последнего ApplyTransform
     //Подсчет радиуса описывающей окружности с центром в (0,0)
     float CalcRadius();
+    friend class Benchmark;
 
 public:
     //Для удобства создания индексов
@@ -28,6 +34,8 @@ public:
     //Внимание! Количество вершин в два раза меньше verts.size()
     Model(const std::vector<GLfloat>& _verts, const std::vector<GLubyte>& _indices);
     Model(const std::vector<GLfloat>& _verts);
+    //Вершины из произвольного буфера (например, из FrameArena), индексы по умолчанию
+    Model(const GLfloat* _verts, size_t count);
 
     //Преобразование вершин происходит на CPU, в этой функции
     void ApplyTransform(const Transform& t);
@@ -38,8 +46,16 @@ public:
 
     float getRadius() const {return radius;};
     float getSquaredRadius() const {return sqrRadius;};
-    void setDraw(bool _draw) {draw = _draw;};
+    Vec2 getCenter() const {return center;};
+    void setDraw(bool _draw) {
+        if(draw != _draw) changed = true;
+        draw = _draw;
+    };
     bool getDraw() const {return draw;};
+    void setOutline(bool _outline) {outline = _outline;};
+    bool isOutline() const {return outline;};
+    bool isChanged() const {return changed;};
+    void resetChanged() {changed = false;};
 
     //Копирование и присваивание запрещено
     Model(const Model&) = delete;
@@ -49,10 +65,9 @@ public:
     //Модели по умолчанию для игровых объектов
     static std::shared_ptr<Model> CreateShip();
     static std::shared_ptr<Model> CreateShipEngine();
-    static std::shared_ptr<Model> CreateAsteroid();
+    static std::shared_ptr<Model> CreateAsteroid(Random& random);
     static std::shared_ptr<Model> CreateBullet();
     static std::shared_ptr<Model> CreateUFO();
-    static std::shared_ptr<Model> CreateExplosion();
 
     //Модели кнопок
     static std::shared_ptr<Model> CreateTriangleBtn();
@@ -62,23 +77,49 @@ public:
     static std::shared_ptr<Model> CreateRestartBtn();
 };
 
+class Renderer;
+
 //Один Batch = один draw call
 class Batch : public std::enable_shared_from_this<Batch> {
+    Renderer& mRenderer;
     std::vector<GLfloat> mVerts;
-    std::vector<GLubyte> mIndices;
+    std::vector<GLushort> mIndices;
     std::function<void()> mSetup;
     std::vector< std::weak_ptr<Model> > mObjects;
 
     GLenum mMode;
+    GLfloat mLineWidth = 1.0f;
+    bool mDecimate = false;
     bool mHudBatch;
     Vec2 renderScale;
 
+    //Собственные буферы, в них лежит последняя загруженная версия Batch
+    GLuint mVertBuf = 0, mIndBuf = 0;
+    GLint mAttrLoc = 0;
+    int mIndCount = 0;
+    //Требуется перепаковка и загрузка независимо от состояния моделей
+    bool mDirty = true;
+    bool IsChanged();
+    //Упаковка в mVerts/mIndices без обращений к OpenGL, размеры в элементах
+    void PackVertices(int& totalVertSize, int& totalIndSize);
+    void Pack();
+    void UpdateScale();
+    float GetAlpha() const;
+    //Смещение вершин модели относительно камеры, false - модель вне экрана
+    bool GetViewOffset(const Model& m, Vec2& offset) const;
+
     friend class Renderer;
+    friend class UnifiedBatch;
+    friend class Benchmark;
     //Определяет масштаб, который будет применяться к объектам этого Batch при отрисовке
     //Всё, что относится к интерфейсу (isHud) живет в рамках всего экрана
     //Игровой мир (!isHud) поддерживается в соотношении сторон Constant::worldRatio
-    Batch(bool isHudBatch);
+    Batch(Renderer& renderer, bool isHudBatch);
+    //Создает буферы в новом контексте OpenGL
+    //Память под упаковку выделяется здесь же, игры без экрана её не тратят
+    void InitGL(GLint attrLoc);
     //Renderer инициирует отрисовку
+    //Вершины перепаковываются и загружаются, только если что-то изменилось
     void Draw();
 
     Batch(const Batch&) = delete;
@@ -89,40 +130,171 @@ public:
     void setSetupFunction(std::function<void()> setup) {mSetup = setup;};
     //Режим отрисовки в смысле OpenGL (GL_LINES, GL_TRIANGLES)
     void setDrawMode(GLenum mode) {mMode = mode;};
+    //Толщина линий в пикселях для режима GL_LINES
+    void setLineWidth(GLfloat width) {mLineWidth = width;};
+    //Контуры (Model::isOutline) рисуются через вершину: два соседних отрезка - одним
+    //Только для отрисовки (и только UnifiedBatch), столкновения считаются по полным моделям
+    void setDecimation(bool decimate) {mDecimate = decimate;};
 
     //Чтобы отрисовать модель, ее нужно добавить в Batch
     void Add(std::weak_ptr<Model> model);
     void Remove(std::weak_ptr<Model> model);
 };
 
+//Все батчи за один draw call. Отрезки разворачиваются в четырехугольники
+//в вершинном шейдере, толщина и прозрачность хранятся в каждой вершине,
+//поэтому glLineWidth и смена uniform между батчами не нужны.
+//Вершина: {x, y, x другого конца отрезка, y другого конца, +-полутолщина, alpha}
+//При Constant::compactVertices вершины загружаются как нормализованные GL_SHORT,
+//шейдер восстанавливает значения через uniform uScale (см. Quantize)
+class UnifiedBatch {
+    static constexpr int vertStride = 6;
+    std::vector<GLfloat> mVerts;
+    std::vector<GLshort> mCompactVerts;
+    std::vector<GLushort> mIndices;
+    GLuint mVertBuf = 0, mIndBuf = 0;
+    GLint mViewportLoc = 0;
+    GLint mScaleLoc = 0;
+    GLint mFeatherLoc = -1;
+    Vec2 mViewport;
+
+    //Статистика загрузки за Constant::renderStatsFrames кадров
+    int mStatsFrames = 0;
+    long long mUploadedBytes = 0;
+    long long mFloatBytes = 0;
+    float mMaxQuantError = 0.0f;
+    void Upload(int vertFrom, int vertTo, int indFrom, int indTo);
+    void LogStats();
+    //Вершины интерфейса лежат в начале буфера и загружаются только при изменении.
+    //Индексы в порядке отрисовки: сначала игровые объекты, затем копия индексов интерфейса
+    //из mStaticIndices, чтобы интерфейс был поверх объектов, как при отдельных батчах
+    std::vector<GLushort> mStaticIndices;
+    int mStaticVertSize = 0;
+    int mStaticIndSize = 0;
+    int mDynamicIndSize = 0;
+
+    friend class Renderer;
+    GLint mAttrLocs[4] = {};
+    UnifiedBatch();
+    void InitGL(GLuint program);
+    //Буфер вершин и формат атрибутов (после отрисовки с другими атрибутами)
+    void BindVertexFormat();
+    //Массивы атрибутов включены, пока активна унифицированная программа
+    void EnableAttribArrays(bool enable);
+    void SetViewport(int width, int height);
+    //Толщина линий и uViewport для цели отрисовки в scale от размера экрана
+    void SetRenderScale(float scale);
+    //Ширина сглаживания краев линий в пикселях (только программа со сглаживанием)
+    void SetFeather(float feather);
+    //Дописывает модели батча в конец буферов начиная с vertSize/indSize
+    //Индексов не больше indCapacity, модели сверх емкости пропускаются
+    void Append(Batch& batch, int& vertSize, int& indSize, int indCapacity = Constant::maxUnifiedIndices);
+    //Собирает и загружает вершины кадра
+    void Update(const std::vector<Batch*>& staticBatches, Batch& dynamicBatch);
+    void DrawStatic();
+    void DrawDynamic();
+    void Draw(const std::vector<Batch*>& staticBatches, Batch& dynamicBatch);
+    friend class Benchmark;
+
+    UnifiedBatch(const UnifiedBatch&) = delete;
+    UnifiedBatch& operator=(const UnifiedBatch&) = delete;
+};
+
+//Масштаб разрешения игровых объектов по времени кадра, с гистерезисом
+//При vsync время кадра не бывает меньше периода обновления, поэтому запас мощности
+//не измерить: масштаб увеличивается пробно после долгой стабильной работы, и если проба
+//сразу приводит к замедлению, следующая откладывается вдвое дольше
+class DynamicResolution {
+    float scale = 1.0f;
+    float avgFrameTime = 0.0f; //0 - кадров еще не было
+    int fastFrames = 0;
+    int cooldown = 0;
+    int upWait = Constant::dynResUpFrames;
+    //Последнее изменение - увеличение, которое еще не подтвердилось
+    bool probing = false;
+
+public:
+    //Возвращает true, если масштаб изменился
+    //targetFrameTime - период обновления экрана или ограничение частоты кадров
+    //canRaise == false - масштаб можно только уменьшать (см. QualityGovernor)
+    bool OnFrame(float frameTime, float targetFrameTime, bool canRaise = true);
+    float getScale() const {return scale;};
+};
+
 //Управляет отрисовкой, контролирует батчи
+//У каждой игры свой Renderer. OpenGL вызывается только из InitGLContext, Draw
+//и OnResolutionChange, поэтому игры без экрана эти функции просто не вызывают
 class Renderer {
-    static GLint uniLoc;
-    static Vec2 goScale;
-    static Vec2 hudScale;
-    static std::unique_ptr<Batch> goBatch;
-    static std::unique_ptr<Batch> hudBatch;
-    static std::unique_ptr<Batch> controlsBatch;
+    GLint uniLoc = 0;
+    GLuint batchProgram = 0;
+    GLuint unifiedProgram = 0;
+    Vec2 goScale = Vec2(1.0f, 1.0f);
+    Vec2 hudScale = Vec2(1.0f, 1.0f);
+    Vec2 camera; //Центр экрана в координатах мира (только Constant::largeWorld)
+    std::unique_ptr<Batch> goBatch;
+    std::unique_ptr<Batch> hudBatch;
+    std::unique_ptr<Batch> controlsBatch;
+    std::unique_ptr<UnifiedBatch> unifiedBatch;
+
+    //Динамическое разрешение: игровые объекты рисуются в левый нижний угол sceneTexture
+    //(размером с экран), затем растягиваются на экран программой blitProgram
+    DynamicResolution dynRes;
+    GLuint blitProgram = 0;
+    GLuint blitBuf = 0;
+    GLint blitPosLoc = 0, blitTexScaleLoc = 0, blitTexMaxLoc = 0;
+    GLuint sceneFramebuffer = 0;
+    GLuint sceneTexture = 0;
+    int screenWidth = 0, screenHeight = 0;
+    bool lineSmoothing = true;
+    void InitSceneTarget();
+    void DrawScaled();
 
     static const std::string vShaderStr, fShaderStr;
+    static const std::string vUnifiedShaderStr, fUnifiedShaderStr;
+    static const std::string vSmoothShaderStr, fSmoothShaderStr;
+    static const std::string vBlitShaderStr, fBlitShaderStr;
     static GLuint LoadShader(GLenum type, const std::string& shaderSrc);
+    //Собирает программу (из кэша или из исходников), 0 - при ошибке
+    static GLuint CreateProgram(const std::string& vShader, const std::string& fShader, const std::string& name);
+
+    //Кэш бинарного представления шейдерных программ (GL_OES_get_program_binary)
+    static std::string programCacheDir;
+    static size_t ProgramCacheKey(const std::string& vShader, const std::string& fShader);
+    static bool LoadProgramBinary(GLuint program, const std::string& path, size_t key);
+    static void SaveProgramBinary(GLuint program, const std::string& path, size_t key);
 
 public:
     //Создает батчи
-    static void InitInternals();
+    Renderer();
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    //Каталог для кэша программы, без него шейдеры всегда компилируются из исходников
+    static void SetCacheDir(const std::string& dir);
+    //Сколько образцов MSAA запрашивать у EGL (см. MainView.java)
+    static int getMultiSamples();
     //Инициализирует OpenGL, может вызываться неоднократно
-    static void InitGLContext();
-    static void Draw();
+    void InitGLContext();
+    void Draw();
+    //Время прошедшего кадра и целевое время, по ним выбирается разрешение (Constant::dynamicResolution)
+    void OnFrameTime(float dt, float targetFrameTime, bool canRaise = true);
+    //Разрешение уже минимальное или не меняется: экономить дальше можно только на качестве
+    bool IsResolutionAtMin() const {return !sceneFramebuffer || dynRes.getScale() <= Constant::dynResMinScale;};
+    //Ступени качества (см. QualityGovernor)
+    void SetLineSmoothing(bool smooth);
+    void SetOutlineDecimation(bool decimate) {goBatch->setDecimation(decimate);};
     //Один к-т для всех полупрозрачных объектов
-    static void SetAlpha(float a);
-    static void OnResolutionChange(int w, int h);
+    void SetAlpha(float a);
+    void OnResolutionChange(int w, int h);
 
-    static Batch& GetGameObjectBatch() { return *goBatch; }; //Игровые объекты
-    static Batch& GetControlsBatch() { return *controlsBatch; }; //Кнопки
-    static Batch& GetHUDBatch() { return *hudBatch; }; //Счёт
+    Batch& GetGameObjectBatch() { return *goBatch; }; //Игровые объекты
+    Batch& GetControlsBatch() { return *controlsBatch; }; //Кнопки
+    Batch& GetHUDBatch() { return *hudBatch; }; //Счёт
 
     //см. конструктор Batch(bool)
-    static Vec2 GetGameObjectScale() {return goScale;};
-    static Vec2 GetHUDScale() {return hudScale;};
+    Vec2 GetGameObjectScale() const {return goScale;};
+    Vec2 GetHUDScale() const {return hudScale;};
+    void SetCamera(const Vec2& pos) {camera = pos;};
+    Vec2 GetCamera() const {return camera;};
 
 };
\ No newline at end of file
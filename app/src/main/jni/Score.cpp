@@ -1,5 +1,7 @@
 #include <Score.h>
-#include <Wrapper.h>
+#include <AllocTracker.h>
+
+#include <algorithm>
 
 ///DigitModel///
 
@@ -18,11 +20,16 @@ const std::array<std::vector<GLubyte>, 10> Score::DigitModel::inds
 //Для всех цифр одни и те же вершины, но разные индексы
 Score::DigitModel::DigitModel() : Model({-w, h,  w, h,  -w, 0,  w, 0,  -w, -h,  w, -h}, inds[0]) {
     curValue = 0;
+    //Смена цифры на шаге копирует индексы без выделения памяти
+    indices.reserve(std::max_element(inds.begin(), inds.end(), [](const std::vector<GLubyte>& a, const std::vector<GLubyte>& b) {
+        return a.size() < b.size();
+    })->size());
 }
 
 void Score::DigitModel::setDigit(unsigned digit) {
     curValue = digit % 10;
     indices = inds[curValue];
+    changed = true;
 }
 
 unsigned Score::DigitModel::getDigit() {
@@ -32,11 +39,12 @@ unsigned Score::DigitModel::getDigit() {
 
 ///Numbers///
 
-void Score::Numbers::Init() {
+void Score::Numbers::Init(Batch& _batch) {
+    batch = &_batch;
     curValue = 0;
     for(auto& i : digits) {
         i = std::make_shared<DigitModel>();
-        Renderer::GetHUDBatch().Add(i);
+        batch->Add(i);
     }
     ApplyTransform(Transform());
     set(0);
@@ -45,8 +53,10 @@ void Score::Numbers::Init() {
 
 Score::Numbers::~Numbers() {
     ready = false;
-    for(auto& i : digits) {
-        Renderer::GetHUDBatch().Remove(i);
+    if(batch) {
+        for(auto& i : digits) {
+            batch->Remove(i);
+        }
     }
 }
 
@@ -61,7 +71,7 @@ void Score::Numbers::set(unsigned num) {
     }
 }
 
-unsigned Score::Numbers::get() {
+unsigned Score::Numbers::get() const {
     return curValue;
 }
 
@@ -87,25 +97,22 @@ void Score::Numbers::ApplyTransform(const Transform& t) {
 
 ///Score///
 
-Score::Numbers Score::cur;
-Score::Numbers Score::high;
-
 void Score::SubmitHighScore() {
-    JavaCall::SubmitHighScore(high.get());
+    platform.SubmitHighScore(high.get());
 }
 
 void Score::ReadHighScore() {
-    high.set(JavaCall::ReadHighScore());
+    high.set(platform.ReadHighScore());
 }
 
-void Score::Init() {
-    cur.Init();
-    high.Init();
+Score::Score(Renderer& _renderer, Platform& _platform) : renderer(_renderer), platform(_platform) {
+    cur.Init(renderer.GetHUDBatch());
+    high.Init(renderer.GetHUDBatch());
     Resize();
 }
 
 void Score::Resize() {
-    float wt = 1.0f / Renderer::GetHUDScale().x;
+    float wt = 1.0f / renderer.GetHUDScale().x;
     float ht = 1.0f;
     cur.ApplyTransform(Vec2(-wt + Constant::scoreDim.x + Constant::scoreMargin,
                              ht - Constant::scoreDim.y - Constant::scoreMargin));
@@ -114,6 +121,7 @@ void Score::Resize() {
 }
 
 void Score::AddPoints(int pointsToAdd) {
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Score);
     cur.add(pointsToAdd);
     if(cur.get() > high.get()) {
         high.set(cur.get());
@@ -121,15 +129,26 @@ void Score::AddPoints(int pointsToAdd) {
     }
 }
 
+void Score::Restore(unsigned points, unsigned highPoints) {
+    cur.set(points);
+    if(highPoints > high.get()) {
+        high.set(highPoints);
+        SubmitHighScore();
+    }
+}
+
 void Score::OnRestart() {
+    AllocTracker::ScopeGuard scope(AllocTracker::Scope::Score);
     cur.set(0);
+    //Запись идёт в фоне, здесь только запрос
+    platform.FlushHighScore();
     ReadHighScore();
 }
 
-int Score::getScore() {
+int Score::getScore() const {
     return cur.get();
 }
 
-int Score::getHighScore() {
+int Score::getHighScore() const {
     return high.get();
 }
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+
 #include <Renderer.h>
+#include <Platform.h>
 
+//Счёт и рекорд одной игры
 class Score {
     //Модель одной цифры
     class DigitModel : public Model {
@@ -17,30 +21,39 @@ class Score {
 
     //Блок цифр
     class Numbers {
+        Batch* batch = nullptr;
         bool ready = false;
         unsigned curValue;
         //Цифры в массиве расположены от младшего разряда к старшему
         std::array<std::shared_ptr<DigitModel>, Constant::scoreDigits> digits;
     public:
-        void Init();
+        void Init(Batch& _batch);
         ~Numbers();
         void set(unsigned num);
-        unsigned get();
+        unsigned get() const;
         void add(unsigned num);
         void ApplyTransform(const Transform& t);
     };
 
-    static void SubmitHighScore();
-    static void ReadHighScore();
+    Renderer& renderer;
+    Platform& platform;
+
+    void SubmitHighScore();
+    void ReadHighScore();
 
-    static Numbers cur;
-    static Numbers high;
+    Numbers cur;
+    Numbers high;
 
 public:
-    static void Init();
-    static void AddPoints(int pointsToAdd);
-    static void OnRestart();
-    static void Resize();
-    static int getScore();
-    static int getHighScore();
+    Score(Renderer& _renderer, Platform& _platform);
+    Score(const Score&) = delete;
+    Score& operator=(const Score&) = delete;
+
+    void AddPoints(int pointsToAdd);
+    //Восстановление из снимка, рекорд не уменьшается
+    void Restore(unsigned points, unsigned highPoints);
+    void OnRestart();
+    void Resize();
+    int getScore() const;
+    int getHighScore() const;
 };
\ No newline at end of file
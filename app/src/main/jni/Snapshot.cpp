@@ -0,0 +1,40 @@
+#include <Snapshot.h>
+
+#include <cstdio>
+
+uint32_t Snapshot::Checksum(const unsigned char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//Пишем во временный файл и переименовываем, чтобы убийство процесса
+//посреди записи не оставило половину снимка
+bool Snapshot::WriteFile(const std::string& path, const std::vector<unsigned char>& data) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f) return false;
+    bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    written = (fclose(f) == 0) && written;
+    if(!written || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::ReadFile(const std::string& path, std::vector<unsigned char>& data) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    data.clear();
+    unsigned char chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    return !data.empty();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//Двоичный снимок состояния игры
+//Значения пишутся как есть (порядок байт платформы): снимок не переносится между архитектурами,
+//зато запись и чтение сводятся к memcpy
+class SnapshotWriter {
+    std::vector<unsigned char>& buf;
+public:
+    explicit SnapshotWriter(std::vector<unsigned char>& _buf) : buf(_buf) {};
+
+    template <class T>
+    void Put(const T& value) {
+        static_assert(std::is_standard_layout<T>::value, "Snapshot stores only plain values");
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(&value);
+        buf.insert(buf.end(), p, p + sizeof(T));
+    };
+
+    template <class T>
+    void PutArray(const std::vector<T>& values) {
+        Put<uint32_t>(values.size());
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(values.data());
+        buf.insert(buf.end(), p, p + values.size() * sizeof(T));
+    };
+
+    void PutString(const std::string& str) {
+        Put<uint32_t>(str.size());
+        buf.insert(buf.end(), str.begin(), str.end());
+    };
+
+    size_t size() const {return buf.size();};
+    unsigned char* at(size_t offset) {return buf.data() + offset;};
+};
+
+//Чтение с проверкой границ: после первой ошибки все Get возвращают false
+class SnapshotReader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool Take(void* dst, size_t n) {
+        if(!ok || size - pos < n) return ok = false;
+        memcpy(dst, data + pos, n);
+        pos += n;
+        return true;
+    };
+
+public:
+    SnapshotReader(const unsigned char* _data, size_t _size) : data(_data), size(_size) {};
+
+    template <class T>
+    bool Get(T& value) {
+        static_assert(std::is_standard_layout<T>::value, "Snapshot stores only plain values");
+        return Take(&value, sizeof(T));
+    };
+
+    template <class T>
+    bool GetArray(std::vector<T>& values) {
+        uint32_t n = 0;
+        if(!Get(n) || n > (size - pos) / sizeof(T)) return ok = false;
+        values.resize(n);
+        return Take(values.data(), n * sizeof(T));
+    };
+
+    bool GetString(std::string& str) {
+        uint32_t n = 0;
+        if(!Get(n) || n > size - pos) return ok = false;
+        str.assign(reinterpret_cast<const char*>(data + pos), n);
+        pos += n;
+        return true;
+    };
+
+    //Данные прочитаны, но не прошли проверку
+    void Fail() {ok = false;};
+    bool isOk() const {return ok;};
+    bool atEnd() const {return pos == size;};
+};
+
+namespace Snapshot {
+    //Заголовок снимка, за ним payloadSize байт данных
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t payloadSize;
+        uint32_t checksum;
+    };
+
+    static constexpr uint32_t magic = 0x54535341; //"ASST"
+    static constexpr uint32_t version = 3;
+
+    //FNV-1a, чтобы не пытаться читать обрезанный или испорченный файл
+    uint32_t Checksum(const unsigned char* data, size_t size);
+
+    bool WriteFile(const std::string& path, const std::vector<unsigned char>& data);
+    bool ReadFile(const std::string& path, std::vector<unsigned char>& data);
+}
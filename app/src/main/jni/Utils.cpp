@@ -1,5 +1,7 @@
 #include <Utils.h>
 
+#include <time.h>
+
 ///Vec2///
 
 float Vec2::getSquaredDist(const Vec2& other) {
@@ -21,20 +23,49 @@ Vec2 Vec2::getNormalized() {
 ///Timer///
 
 Timer::Timer()  {
-    mTime = std::chrono::system_clock::now();
-    mStartTime = std::chrono::system_clock::now();
+    mTime = std::chrono::steady_clock::now();
+    mStartTime = std::chrono::steady_clock::now();
 }
 
 float Timer::Tick() {
     mPrevTime = mTime;
-    mTime = std::chrono::system_clock::now();
+    mTime = std::chrono::steady_clock::now();
     return std::chrono::duration_cast<std::chrono::microseconds>
         (mTime - mPrevTime).count() / Constant::microsecondsInSecond;
 }
 
 float Timer::getTotalTime() {
     return std::chrono::duration_cast<std::chrono::microseconds>
-        (std::chrono::system_clock::now() - mStartTime).count() / Constant::microsecondsInSecond;
+        (std::chrono::steady_clock::now() - mStartTime).count() / Constant::microsecondsInSecond;
+}
+
+
+///StartupTrace///
+
+//До вызова Begin отсчет ведется от первого обращения
+long long StartupTrace::startNs = 0;
+bool StartupTrace::finished = false;
+
+long long StartupTrace::Now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void StartupTrace::Begin(long long loadStartNs) {
+    startNs = loadStartNs;
+}
+
+void StartupTrace::Mark(const char* stage) {
+    if(finished) return;
+    if(startNs == 0) startNs = Now();
+    LOGI("Startup: %s at %.2f ms", stage, (Now() - startNs) / 1000000.0);
+}
+
+void StartupTrace::Finish() {
+    if(finished) return;
+    Mark("first frame");
+    finished = true;
 }
 
 
@@ -45,5 +76,6 @@ bool Random::flipCoin() {
     return distribution(generator);
 }
 
-//Инициализируем текущим временем
-std::default_random_engine Random::generator(std::chrono::system_clock::now().time_since_epoch().count());
\ No newline at end of file
+unsigned Random::TimeSeed() {
+    return std::chrono::system_clock::now().time_since_epoch().count();
+}
\ No newline at end of file
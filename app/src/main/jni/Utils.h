@@ -8,6 +8,11 @@
 #include <android/log.h>
 #include <GLES2/gl2.h>
 
+#include <FastMath.h>
+
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "Asteroids", __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, "Asteroids", __VA_ARGS__)
+
 struct Vec2 {
     float x, y;
 
@@ -60,8 +65,104 @@ struct Vec2 {
 namespace Constant {
     static constexpr bool continuousCollisions = true;
     static constexpr bool refineCollisions = true;
-
-    static constexpr int maxBatchSize = 2048;
+    //Пуля проверяется как луч, заметённый за шаг, против контура цели (см. Game::RefineBulletCollision)
+    static constexpr bool bulletRayCollisions = true;
+    //Грубая проверка по окружностям сразу для строки пар по массивам (векторизуется)
+    static constexpr bool packedBroadPhase = true;
+    //Начальная емкость массивов широкой фазы, чтобы шаг не расширял их в куче
+    static constexpr int collisionReserve = 256;
+    //Широкая фаза по умолчанию: sweep and prune вместо перебора всех пар (см. Game::SetBroadPhase)
+    static constexpr bool sweepAndPrune = false;
+    //Проверка точности FastMath при запуске (результаты и превышения границ в лог)
+    static constexpr bool checkFastMath = false;
+    //Микробенчмарки (Benchmark.h) при запуске, результаты в лог
+    static constexpr bool runBenchmarks = false;
+
+    //Память для временных данных одного шага (см. FrameArena), байт
+    static constexpr int frameArenaSize = 64 * 1024;
+    //Отладка: шаг игры, обратившийся к куче, падает на assert (в релизе - предупреждение в лог)
+    static constexpr bool frameHeapGuard = false;
+    //Учет выделений памяти по подсистемам и местам (см. AllocTracker.h), отчет в лог
+    static constexpr bool trackAllocations = false;
+    static constexpr int allocReportFrames = 600;
+    static constexpr int allocReportSites = 10;
+    //Перехват вызовов OpenGL (см. GLTrace.h): счетчики за кадр в лог раз в glTraceFrames кадров,
+    //glGetError после каждого вызова, запись потока команд в files/gl_capture.bin
+    static constexpr bool glTrace = false;
+    static constexpr int glTraceFrames = 300;
+    static constexpr bool glCheckErrors = false;
+    static constexpr bool glCapture = false;
+    static constexpr int glCaptureFrames = 120;
+    static constexpr bool glIntercept = glTrace || glCheckErrors || glCapture;
+
+    //Запись партий в files/session.rec (см. Recording.h)
+    static constexpr bool recordSessions = false;
+    static constexpr int recordKeyframeInterval = 600;
+    static constexpr int recordPosScale = 4096;
+    static constexpr int recordVelScale = 65536;
+    //Закодированные кадры копятся в памяти и отдаются потоку записи порциями такого размера
+    static constexpr int recordWriteBytes = 64 * 1024;
+
+    //Неподвижный кадр (пауза без ввода) не перерисовывается, см. Game::IsFrameStatic
+    static constexpr bool idleThrottling = true;
+
+    static constexpr int maxBatchSize = 4096;
+    //Все батчи одним draw call (см. UnifiedBatch), иначе - по draw call на батч
+    static constexpr bool unifiedRendering = true;
+    static constexpr int maxUnifiedVerts = 8192;
+    static constexpr int maxUnifiedIndices = 12288;
+    //Вершины UnifiedBatch в 16-битных координатах, вдвое меньше данных на кадр
+    //Координаты в [-quantRange, quantRange] с шагом 2*quantRange/65534, т.е. ~6e-5 NDC:
+    //на 4K (3840 пикселей по ширине) погрешность не больше 0.06 пикселя
+    static constexpr bool compactVertices = true;
+    static constexpr float quantRange = 2.0f;
+    static constexpr float quantMaxHalfWidth = 32.0f;
+    //Вывод статистики загрузки вершин и погрешности квантования в лог
+    static constexpr bool logRenderStats = false;
+    static constexpr int renderStatsFrames = 600;
+
+    //Сглаживание линий в шейдере по покрытию пикселя (только unifiedRendering),
+    //тогда MSAA не нужен: буфер кадра запрашивается с smoothLineSamples образцами
+    static constexpr bool smoothLines = true;
+    static constexpr int smoothLineSamples = 0;
+    //Без сглаживания в шейдере
+    static constexpr int msaaSamples = 16;
+    //Динамическое разрешение (только unifiedRendering, см. DynamicResolution):
+    //игровые объекты рисуются в текстуру размером от dynResMinScale до 100% экрана
+    //и растягиваются на экран, интерфейс всегда в полном разрешении
+    static constexpr bool dynamicResolution = true;
+    static constexpr float dynResMinScale = 0.5f;
+    static constexpr float dynResStep = 0.125f;
+    //Цель - период обновления экрана (см. FramePacer), а не постоянная частота:
+    //среднее время кадра выше цели в dynResSlowRatio раз - разрешение уменьшается
+    static constexpr float dynResSlowRatio = 1.2f;
+    //Не выше цели в dynResFastRatio раз dynResUpFrames кадров подряд - пробуем увеличить
+    static constexpr float dynResFastRatio = 1.05f;
+    static constexpr int dynResUpFrames = 180;
+    static constexpr int dynResMaxUpFrames = 1800;
+    //После изменения масштаба решения не принимаются, пока не установится среднее
+    static constexpr int dynResCooldownFrames = 30;
+    //Более длинные кадры (пауза, загрузка) не учитываются
+    static constexpr float dynResMaxFrameTime = 0.25f;
+    //Ступени снижения качества после минимального разрешения (см. QualityGovernor.h)
+    static constexpr bool qualityGovernor = true;
+    static constexpr float governorSlowRatio = 1.25f;
+    //Повышение, только если работа на CPU занимает меньше этой доли бюджета
+    static constexpr float governorWorkRatio = 0.5f;
+    //Пробы вверх реже, чем у разрешения: ступени заметнее, а перегрев накапливается минутами
+    static constexpr int governorUpFrames = 600;
+    static constexpr int governorMaxUpFrames = 7200;
+    static constexpr int governorCooldownFrames = 60;
+    static constexpr int governorSpikeStep = 2;
+    static constexpr float governorCappedFrameTime = 1.0f / 30.0f;
+    //Шаг симуляции по vsync от Choreographer (см. FramePacer.h), иначе - по таймеру
+    static constexpr bool framePacing = true;
+    static constexpr float defaultRefreshRate = 60.0f;
+    //Через сколько периодов после vsync кадр попадает на экран
+    static constexpr int presentLatencyFrames = 2;
+    //Отрисовка, начатая позже этой доли периода после vsync, считается запоздавшей
+    static constexpr float lateFrameRatio = 0.5f;
+    static constexpr int jankReportFrames = 600;
 
     static constexpr int gameObjectLineWidth = 2;
     static constexpr int interfaceLineWidth = 3;
@@ -85,6 +186,17 @@ namespace Constant {
     static constexpr float worldRatio = 16.0f / 9.0f;
     static constexpr float inverseWorldRatio = 0.5625f;
 
+    //Большой мир из worldScreens x worldScreens экранов, камера следует за кораблем
+    static constexpr bool largeWorld = false;
+    static constexpr int worldScreens = 4;
+    //Половина размера мира по осям
+    static constexpr float worldXExtent = worldRatio * (largeWorld ? worldScreens : 1);
+    static constexpr float worldYExtent = largeWorld ? worldScreens : 1.0f;
+    //В большом мире объекты дальше simLodDistance от игрока
+    //обновляются раз в simLodInterval шагов с накопленным временем
+    static constexpr float simLodDistance = 3.0f;
+    static constexpr int simLodInterval = 4;
+
     static constexpr bool vibrateOnDeath = true;
     static constexpr float restartAfterDeathSec = 1.5f;
     static constexpr float shipRotationSpeed = 3.5f;
@@ -105,6 +217,7 @@ namespace Constant {
     static constexpr float asteroidRadiusDistribution = 0.65f;
     static constexpr int asteroidVertCount = 12;
     static constexpr int explosionVertCount = 12;
+    static constexpr int explosionMaxCount = 24;
     static constexpr int explosionMaxScale = 4;
     static constexpr float explosionLifetime = 0.6f;
     static constexpr float explosionSpikeLen = 0.015f;
@@ -130,10 +243,11 @@ namespace Constant {
     static constexpr float smallNumber = 0.0001f;
 };
 
+//На steady_clock: системное время может переводиться и давать отрицательные шаги
 class Timer {
-    std::chrono::time_point<std::chrono::system_clock> mTime;
-    std::chrono::time_point<std::chrono::system_clock> mPrevTime;
-    std::chrono::time_point<std::chrono::system_clock> mStartTime;
+    std::chrono::time_point<std::chrono::steady_clock> mTime;
+    std::chrono::time_point<std::chrono::steady_clock> mPrevTime;
+    std::chrono::time_point<std::chrono::steady_clock> mStartTime;
 
 public:
     Timer();
@@ -143,12 +257,27 @@ public:
     float getTotalTime();
 };
 
+//Трассировка холодного старта: от System.loadLibrary до первого кадра
+//Время отсчитывается по CLOCK_MONOTONIC, как и System.nanoTime() в Java
+class StartupTrace {
+    static long long startNs;
+    static bool finished;
+    static long long Now();
+
+public:
+    //loadStartNs - System.nanoTime() перед System.loadLibrary
+    static void Begin(long long loadStartNs);
+    //Выводит в лог время этапа, после Finish() вызовы игнорируются
+    static void Mark(const char* stage);
+    static void Finish();
+};
+
 //Положение в игровом мире
 class Transform : public std::enable_shared_from_this<Transform> {
-    static constexpr float worldWidth = 1.99f * Constant::worldRatio;
-    static constexpr float worldHeight = 1.99f;
-    static constexpr float worldXMax = Constant::worldRatio;
-    static constexpr float worldYMax = 1.f;
+    static constexpr float worldWidth = 1.99f * Constant::worldXExtent;
+    static constexpr float worldHeight = 1.99f * Constant::worldYExtent;
+    static constexpr float worldXMax = Constant::worldXExtent;
+    static constexpr float worldYMax = Constant::worldYExtent;
     float angle, angleSin, angleCos;
     Vec2 pos, scale;
     //Расстояние, на которое можно зайти за границы экрана
@@ -159,12 +288,32 @@ public:
     //Имитируем зацикленность игрового мира
     //Вызывается при каждом изменении позиции
     void ClampPos() {
+        if(Constant::largeWorld) {
+            //Большой мир - тор без полей, объекты у шва переносит камера (см. WrapDelta)
+            if(pos.x < -worldXMax) pos.x += 2 * worldXMax;
+            if(pos.x >= worldXMax) pos.x -= 2 * worldXMax;
+            if(pos.y < -worldYMax) pos.y += 2 * worldYMax;
+            if(pos.y >= worldYMax) pos.y -= 2 * worldYMax;
+            return;
+        }
         if(pos.x < -worldXMax - margin) pos.x += worldWidth + 2 * margin;
         if(pos.x > worldXMax + margin)  pos.x -= worldWidth + 2 * margin;
         if(pos.y < -worldYMax - margin) pos.y += worldHeight + 2 * margin;
         if(pos.y > worldYMax + margin)  pos.y -= worldHeight + 2 * margin;
     };
 
+    //Кратчайшее смещение с учетом зацикленности большого мира
+    //В обычном мире объекты зацикливаются за экраном, смещение не меняется
+    static Vec2 WrapDelta(Vec2 d) {
+        if(Constant::largeWorld) {
+            if(d.x < -worldXMax) d.x += 2 * worldXMax;
+            if(d.x > worldXMax) d.x -= 2 * worldXMax;
+            if(d.y < -worldYMax) d.y += 2 * worldYMax;
+            if(d.y > worldYMax) d.y -= 2 * worldYMax;
+        }
+        return d;
+    };
+
     void setPos(const Vec2& _pos) {
         pos = _pos;
         ClampPos();
@@ -177,8 +326,7 @@ public:
     //Заранее подсчитываем синус и косинус при каждом изменении угла
     void setAngle(float _angle) {
         angle = _angle;
-        angleSin = sin(angle);
-        angleCos = cos(angle);
+        FastMath::SinCos(angle, angleSin, angleCos);
     };
 
     float getAngle() const {
@@ -226,9 +374,13 @@ public:
     ~Transform() = default;
 };
 
+//Генератор случайных чисел, у каждой игры свой
 struct Random {
-    //Предоставляем доступ к генератору
-    static std::default_random_engine generator;
+    std::default_random_engine generator;
+
+    explicit Random(unsigned seed) : generator(seed) {};
     //true/false c вероятностью 0.5
-    static bool flipCoin();
+    bool flipCoin();
+    //Зерно по текущему времени
+    static unsigned TimeSeed();
 };
\ No newline at end of file
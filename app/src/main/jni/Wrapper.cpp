@@ -1,14 +1,25 @@
 #include <jni.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <Game.h>
+#include <Benchmark.h>
+#include <GLTrace.h>
 #include <Wrapper.h>
-#include <Controls.h>
 
 extern "C" {
     JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM * vm, void * reserved);
+    JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Init(JNIEnv *, jclass, jlong, jstring);
+    JNIEXPORT jint JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GetMultiSamples(JNIEnv *, jclass);
     JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GLCreated(JNIEnv *, jclass);
 	JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GLChanged(JNIEnv *, jclass, jint, jint);
-	JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Update(JNIEnv *, jclass);
+	JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_SetRefreshRate(JNIEnv *, jclass, jfloat);
+	JNIEXPORT jboolean JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Update(JNIEnv *, jclass, jlong);
 	JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPointerDown
                                         (JNIEnv *env, jclass obj, jint id, jfloat x, jfloat y);
     JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPointerUp
@@ -19,21 +30,158 @@ extern "C" {
     JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnResume(JNIEnv *, jclass);
 };
 
-static Game& gGame = Game::Get(); //Конструктор Game вызывается тут
-
 static JavaVM* gjvm = 0;
 static jclass wrapper = 0;
 static jmethodID submitHS;
 static jmethodID readHS;
 static jmethodID vibrate;
 
+//JNIEnv кэшируется для каждого потока, AttachCurrentThread вызывается один раз.
+//При завершении потока деструктор ключа отсоединяет его от JVM
+static pthread_key_t envKey;
+
+static void DetachThread(void* env) {
+    if(gjvm) gjvm->DetachCurrentThread();
+}
+
+static JNIEnv* GetEnv() {
+    JNIEnv* env = static_cast<JNIEnv*>(pthread_getspecific(envKey));
+    if(!env && gjvm) {
+        if(gjvm->AttachCurrentThread(&env, NULL) != JNI_OK) return 0;
+        pthread_setspecific(envKey, env);
+    }
+    return env;
+}
+
+//Очередь вызовов Java. Обслуживается отдельным потоком, чтобы ни вибрация,
+//ни запись рекорда (SharedPreferences.commit(), т.е. диск) не выполнялись в потоке GL
+class CallQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    int vibrations = 0;
+    //Рекорды объединяются: на диск пишется только последний, и только по запросу
+    int pendingScore = -1;
+    bool persistRequested = false;
+    //Рекорд читается с диска один раз при запуске, дальше используется кэш
+    int highScore = 0;
+    bool highScoreRead = false;
+
+    void Run() {
+        JNIEnv* env = GetEnv();
+        if(!env) {
+            //Без JVM работаем только с кэшем, чтобы ReadHighScore не ждал вечно
+            std::lock_guard<std::mutex> lock(mutex);
+            highScoreRead = true;
+            cv.notify_all();
+            return;
+        }
+
+        int score = env->CallStaticIntMethod(wrapper, readHS);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            highScore = std::max(highScore, score);
+            highScoreRead = true;
+        }
+        cv.notify_all();
+
+        while(true) {
+            int vibrateNum = 0;
+            int scoreToWrite = -1;
+            {
+                //Забираем всё накопленное за раз, сами вызовы делаем без блокировки
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return vibrations > 0 || (persistRequested && pendingScore >= 0); });
+                std::swap(vibrateNum, vibrations);
+                if(persistRequested) {
+                    std::swap(scoreToWrite, pendingScore);
+                    persistRequested = false;
+                }
+            }
+            //Несколько вибраций за один кадр неотличимы от одной
+            if(vibrateNum > 0) env->CallStaticVoidMethod(wrapper, vibrate);
+            if(scoreToWrite >= 0) env->CallStaticVoidMethod(wrapper, submitHS, scoreToWrite);
+        }
+    }
+
+public:
+    void Start() {
+        std::thread(&CallQueue::Run, this).detach();
+    }
+
+    void Vibrate() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            vibrations++;
+        }
+        cv.notify_all();
+    }
+
+    void SubmitHighScore(int score) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(score > highScore) {
+            highScore = score;
+            pendingScore = score;
+        }
+    }
+
+    void FlushHighScore() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            persistRequested = pendingScore >= 0;
+        }
+        cv.notify_all();
+    }
+
+    //Ждать приходится только если чтение с диска еще не закончилось (первый кадр)
+    int ReadHighScore() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(gjvm) cv.wait(lock, [this]() { return highScoreRead; });
+        return highScore;
+    }
+};
+
+//Живёт до завершения процесса вместе с рабочим потоком
+static CallQueue& gCalls = *new CallQueue();
+
+//Платформа для игры, которую показывает приложение
+class JavaPlatform : public Platform {
+public:
+    int ReadHighScore() override {return JavaCall::ReadHighScore();};
+    void SubmitHighScore(int score) override {JavaCall::SubmitHighScore(score);};
+    void FlushHighScore() override {JavaCall::FlushHighScore();};
+    void Vibrate() override {JavaCall::Vibrate();};
+};
+
+//Снимок игры, сохранённый при паузе. Пустой путь - сохранение отключено
+static std::string gSnapshotPath;
+static bool gSnapshotChecked = false;
+//Запись партий, если включена Constant::recordSessions
+static std::string gRecordingPath;
+
+//Игра приложения создаётся лениво при первом обращении из потока GL, а не при загрузке библиотеки
+static Game& GetGame() {
+    static JavaPlatform platform;
+    static Game game(Random::TimeSeed(), &platform);
+    static bool created = [] {
+        StartupTrace::Mark("Game created");
+        if(Constant::checkFastMath) FastMath::CheckAccuracy();
+        if(Constant::runBenchmarks) Benchmark::Log(Benchmark::Run());
+        if(Constant::recordSessions && !gRecordingPath.empty()) game.StartRecording(gRecordingPath);
+        return true;
+    }();
+    (void)created;
+    return game;
+}
+
 ///С++ из Java///
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
     JNIEnv* env;
     gjvm = vm;
-    if(gjvm->AttachCurrentThread( (JNIEnv **) &env, NULL) != JNI_OK) return -1;
-    jclass local = env->FindClass("com/hardcore/mk/asteroids/NativeWrapper");
+    if(gjvm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) return -1;
+    if(pthread_key_create(&envKey, DetachThread) != 0) return -1;
+    jclass local = env->FindClass("test/zeptoteam/mk/asteroids/NativeWrapper");
     if (!local) return -1;
 
     wrapper = reinterpret_cast<jclass>(env->NewGlobalRef(local));
@@ -41,71 +189,118 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
         vibrate = env->GetStaticMethodID(wrapper, "Vibrate", "()V");
         readHS = env->GetStaticMethodID(wrapper, "ReadHighScore", "()I");
         submitHS = env->GetStaticMethodID(wrapper, "SubmitHighScore", "(I)V");
+        gCalls.Start();
         return JNI_VERSION_1_6;
     } else {
         return -1;
     }
 }
 
+JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Init
+                                    (JNIEnv *env, jclass obj, jlong loadStartNs, jstring filesDir) {
+    StartupTrace::Begin(loadStartNs);
+    StartupTrace::Mark("library loaded");
+    const char* dir = env->GetStringUTFChars(filesDir, NULL);
+    Renderer::SetCacheDir(dir);
+    gSnapshotPath = std::string(dir) + "/snapshot.bin";
+    gRecordingPath = std::string(dir) + "/session.rec";
+    GLTrace::SetCapturePath(std::string(dir) + "/gl_capture.bin");
+    env->ReleaseStringUTFChars(filesDir, dir);
+}
+
+JNIEXPORT jint JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GetMultiSamples (JNIEnv *env, jclass obj) {
+    return Renderer::getMultiSamples();
+}
+
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GLCreated (JNIEnv *env, jclass obj) {
-    gGame.OnGLInit();
+    GetGame().OnGLInit();
 }
 
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_GLChanged (JNIEnv *env, jclass obj, jint width, jint height) {
-    gGame.OnResolutionChange(width, height);
+    GetGame().OnResolutionChange(width, height);
 }
 
-JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Update (JNIEnv *env, jclass obj) {
-    gGame.Update();
+JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_SetRefreshRate (JNIEnv *env, jclass obj, jfloat hz) {
+    GetGame().SetRefreshRate(hz);
+}
+
+//false - кадр неподвижен, следующий можно рисовать только по вводу
+//С ограничением частоты кадров поток GL ждет срока следующего кадра,
+//сам eglSwapBuffers выдает кадры с частотой экрана
+JNIEXPORT jboolean JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_Update (JNIEnv *env, jclass obj, jlong vsyncNanos) {
+    static std::chrono::steady_clock::time_point nextFrame;
+    const float interval = GetGame().GetFrameInterval();
+    if(interval > 0.0f) {
+        std::this_thread::sleep_until(nextFrame);
+        const auto now = std::chrono::steady_clock::now();
+        nextFrame = std::max(nextFrame, now - std::chrono::milliseconds(1)) +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(interval));
+    }
+    GetGame().Update(vsyncNanos);
+    StartupTrace::Finish();
+    return GetGame().IsFrameStatic() ? JNI_FALSE : JNI_TRUE;
 }
 
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPointerDown
                                     (JNIEnv *env, jclass obj, jint id, jfloat x, jfloat y) {
-    Controls::onPointerDown(id, x, y);
+    GetGame().GetControls().onPointerDown(id, x, y);
 }
 
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPointerUp
                                     (JNIEnv *env, jclass obj, jint id, jfloat x, jfloat y) {
-    Controls::onPointerUp(id, x, y);
+    GetGame().GetControls().onPointerUp(id, x, y);
 }
 
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPointerMove
                                     (JNIEnv *env, jclass obj, jint id, jfloat x, jfloat y) {
-    Controls::onPointerMove(id, x, y);
+    GetGame().GetControls().onPointerMove(id, x, y);
 }
 
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnPause(JNIEnv *, jclass) {
-    gGame.Pause();
+    GetGame().Pause();
+    //Процесс может быть завершен после паузы, сохраняем рекорд и весь мир
+    JavaCall::FlushHighScore();
+    GetGame().FlushRecording();
+    if(!gSnapshotPath.empty()) {
+        Timer timer;
+        std::vector<unsigned char> data;
+        GetGame().SaveSnapshot(data);
+        if(Snapshot::WriteFile(gSnapshotPath, data)) {
+            LOGI("Snapshot saved: %d bytes, %.3f ms", (int)data.size(), timer.getTotalTime() * 1000.0);
+        } else {
+            LOGW("Failed to write snapshot %s", gSnapshotPath.c_str());
+        }
+    }
 }
 
+//Первое возобновление после запуска процесса - продолжаем игру из снимка, если он есть
 JNIEXPORT void JNICALL Java_test_zeptoteam_mk_asteroids_NativeWrapper_OnResume(JNIEnv *, jclass) {
-
+    if(gSnapshotChecked || gSnapshotPath.empty()) return;
+    gSnapshotChecked = true;
+    std::vector<unsigned char> data;
+    if(Snapshot::ReadFile(gSnapshotPath, data)) {
+        Timer timer;
+        bool restored = GetGame().LoadSnapshot(data.data(), data.size());
+        LOGI("Snapshot %s: %d bytes, %.3f ms", restored ? "restored" : "rejected",
+             (int)data.size(), timer.getTotalTime() * 1000.0);
+    }
 }
 
 
 ///Java из C++///
 
 void JavaCall::Vibrate() {
-    if(gjvm) {
-        JNIEnv* env;
-        if(gjvm->AttachCurrentThread( (JNIEnv **) &env, NULL) != JNI_OK) return;
-        env->CallStaticVoidMethod(wrapper, vibrate);
-    }
+    gCalls.Vibrate();
 }
 
 int JavaCall::ReadHighScore() {
-    if(gjvm) {
-        JNIEnv* env;
-        if(gjvm->AttachCurrentThread( (JNIEnv **) &env, NULL) != JNI_OK) return 0;
-        return env->CallStaticIntMethod(wrapper, readHS);
-    }
-    return 0;
+    return gCalls.ReadHighScore();
 }
 
 void JavaCall::SubmitHighScore(int score) {
-    if(gjvm) {
-        JNIEnv* env;
-        if(gjvm->AttachCurrentThread( (JNIEnv **) &env, NULL) != JNI_OK) return;
-        env->CallStaticVoidMethod(wrapper, submitHS, score);
-    }
-}
\ No newline at end of file
+    gCalls.SubmitHighScore(score);
+}
+
+void JavaCall::FlushHighScore() {
+    gCalls.FlushHighScore();
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 //см. NativeWrapper.java
+//Вызовы ставятся в очередь и выполняются в отдельном потоке,
+//поэтому их можно безопасно делать из Game::Update
 namespace JavaCall {
+    //Рекорд читается с диска один раз, далее возвращается закэшированное значение
     int ReadHighScore();
+    //Последовательные рекорды объединяются, на диск попадает только последний
     void SubmitHighScore(int score);
+    //Записать рекорд на диск (при паузе и перезапуске)
+    void FlushHighScore();
     void Vibrate();
-};
\ No newline at end of file
+};